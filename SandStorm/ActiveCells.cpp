@@ -0,0 +1,141 @@
+#include "ActiveCells.h"
+
+#include <bit>
+
+ActiveCells::ActiveCells(SandStorm::CellInfo* map, int width, int height)
+{
+    this->map = map;
+    this->width = width;
+    this->height = height;
+
+    wordsPerRow = width / 64;
+    awake.resize(wordsPerRow * height);
+    awakeNext.resize(wordsPerRow * height);
+    queued.resize(wordsPerRow * height);
+}
+
+//Start a new tick, cells woken last tick become this tick's awake cells
+void ActiveCells::BeginTick(bool queueSand)
+{
+    std::swap(awake, awakeNext);
+    std::fill(awakeNext.begin(), awakeNext.end(), 0);
+    std::fill(queued.begin(), queued.end(), 0);
+
+    for (auto& bucket : buckets)
+    {
+        bucket.clear();
+    }
+
+    this->queueSand = queueSand;
+    inTick = true;
+}
+
+//Stop queueing woken cells into this tick's buckets
+void ActiveCells::EndTick()
+{
+    inTick = false;
+}
+
+//Queue all awake cells of a row that are also set in the given mask (nullptr = whole row)
+void ActiveCells::QueueRow(int y, const uint64_t* mask, bool leftToRight)
+{
+    const int row = y * wordsPerRow;
+    for (int i = 0; i < wordsPerRow; i++)
+    {
+        int w = leftToRight ? i : wordsPerRow - 1 - i;
+        uint64_t bits = awake[row + w] & ~queued[row + w];
+        if (mask != nullptr) bits &= mask[w];
+
+        while (bits != 0)
+        {
+            int bit = leftToRight ? std::countr_zero(bits) : 63 - std::countl_zero(bits);
+            bits &= ~(1ull << bit);
+
+            int index = (row + w) * 64 + bit;
+            queued[index / 64] |= 1ull << bit;
+            if (!IsStatic(map[index].type))
+                buckets[map[index].type].push_back(index);
+        }
+    }
+}
+
+//Wake a cell and its 8 neighbours for the next tick, during a tick they are also queued right away
+void ActiveCells::Wake(int index)
+{
+    int x = index % width;
+    int y = index / width;
+
+    for (int neighbourY = std::max(y - 1, 0); neighbourY <= std::min(y + 1, height - 1); neighbourY++)
+    {
+        for (int neighbourX = std::max(x - 1, 0); neighbourX <= std::min(x + 1, width - 1); neighbourX++)
+        {
+            int neighbour = neighbourX + width * neighbourY;
+            awakeNext[neighbour / 64] |= 1ull << (neighbour % 64);
+
+            if (inTick) Queue(neighbour);
+        }
+    }
+}
+
+//Keep a single cell awake for the next tick (cells that didn't change but can still move/react)
+void ActiveCells::KeepAwake(int index)
+{
+    awakeNext[index / 64] |= 1ull << (index % 64);
+}
+
+//Put a single cell to sleep for the next tick (cells that became part of a settled liquid pool)
+void ActiveCells::Sleep(int index)
+{
+    awakeNext[index / 64] &= ~(1ull << (index % 64));
+}
+
+//Wake every cell, used after the grid changed without going through SandStorm::OnCellChanged
+void ActiveCells::WakeAll()
+{
+    std::fill(awakeNext.begin(), awakeNext.end(), ~0ull);
+}
+
+//Clear all awake cells (an empty grid has nothing to update)
+void ActiveCells::Reset()
+{
+    std::fill(awake.begin(), awake.end(), 0);
+    std::fill(awakeNext.begin(), awakeNext.end(), 0);
+    std::fill(queued.begin(), queued.end(), 0);
+
+    for (auto& bucket : buckets)
+    {
+        bucket.clear();
+    }
+}
+
+//Returns the amount of cells that got queued this tick
+int ActiveCells::GetQueuedCount()
+{
+    int count = 0;
+    for (const auto& bucket : buckets)
+    {
+        count += static_cast<int>(bucket.size());
+    }
+    return count;
+}
+
+//Append a cell woken during the tick to its bucket, the bottom row never updates
+void ActiveCells::Queue(int index)
+{
+    uint64_t bit = 1ull << (index % 64);
+    if ((queued[index / 64] & bit) != 0 || index >= width * (height - 1))
+        return;
+
+    unsigned char type = map[index].type;
+    if (IsStatic(type) || (!queueSand && type == Element::Elements::SAND))
+        return;
+
+    queued[index / 64] |= bit;
+    buckets[type].push_back(index);
+}
+
+//Returns true for cells that never update on their own
+bool ActiveCells::IsStatic(unsigned char type)
+{
+    return type == Element::Elements::UNOCCUPIED || type == Element::Elements::WALL || type == Element::Elements::OBSIDIAN;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "SandStorm.h"
+
+class ActiveCells
+{
+public:
+	ActiveCells(SandStorm::CellInfo* map, int width, int height);
+
+	void BeginTick(bool queueSand = true);
+	void EndTick();
+	void QueueRow(int y, const uint64_t* mask, bool leftToRight);
+
+	void Wake(int index);
+	void KeepAwake(int index);
+	void Sleep(int index);
+	void WakeAll();
+	void Reset();
+
+	int GetQueuedCount();
+
+	std::vector<int> buckets[Element::ELEMENT_COUNT]; //cell indices to update this tick, one list per element in scan order
+
+private:
+	void Queue(int index);
+	static bool IsStatic(unsigned char type);
+
+	SandStorm::CellInfo* map = nullptr;
+	int width = 0;
+	int height = 0;
+	int wordsPerRow = 0;
+
+	//one bit per cell, 64 cells per word
+	std::vector<uint64_t> awake; //cells that get updated this tick
+	std::vector<uint64_t> awakeNext; //cells that get updated next tick
+	std::vector<uint64_t> queued; //cells that are already in a bucket this tick
+
+	bool inTick = false;
+	bool queueSand = true; //false when sand is moved by the bitplane engine, only sand from the generic mask gets queued
+};
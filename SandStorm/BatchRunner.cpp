@@ -0,0 +1,94 @@
+#include "BatchRunner.h"
+#include "MargolusEngine.h"
+
+BatchRunner::BatchRunner(int threadCount)
+{
+    this->threadCount = threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+}
+
+//Simulate a batch of seeded worlds, every worker thread owns one headless world and keeps taking jobs until all are done
+void BatchRunner::Run(int worldCount)
+{
+    //worlds are created up front, raylib's file/path helpers aren't safe to call from multiple threads
+    std::vector<SandStorm*> worlds;
+    for (int i = 0; i < std::min(threadCount, worldCount); i++)
+    {
+        SandStorm* world = new SandStorm(true);
+        world->updateEngine = updateEngine;
+        world->updateScheduler->adaptive = false; //tick time based degrading isn't deterministic
+        world->margolusEngine->threadCount = 1; //parallelism comes from running worlds side by side
+        worlds.push_back(world);
+    }
+
+    int sceneCount = worlds.empty() ? 0 : worlds[0]->imageImporter->GetImageCount();
+    if (sceneCount == 0)
+    {
+        std::cout << "[batch] no scenes found in Textures/Images\n";
+        for (SandStorm* world : worlds) delete world;
+        return;
+    }
+
+    jobs.clear();
+    for (int i = 0; i < worldCount; i++) //cycle through the stock scenes, every world gets its own seed
+    {
+        jobs.push_back({ i % sceneCount, firstSeed + i });
+    }
+    results.assign(jobs.size(), BatchResult());
+    nextJob = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (SandStorm* world : worlds)
+    {
+        workers.emplace_back(&BatchRunner::RunWorker, this, world);
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    double totalWorldMs = 0;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        std::cout << "[batch] world " << i << " " << results[i].sceneName << " seed " << jobs[i].seed << ": " 
+            << std::hex << results[i].finalHash << std::dec << " (" << results[i].milliseconds << " ms)\n";
+        totalWorldMs += results[i].milliseconds;
+    }
+
+    double totalTicks = static_cast<double>(ticksPerWorld) * static_cast<double>(jobs.size());
+    std::cout << "[batch] " << jobs.size() << " worlds x " << ticksPerWorld << " ticks on " << workers.size() << " threads: " 
+        << elapsed.count() << " ms, " << totalTicks / (elapsed.count() / 1000.0) << " ticks/s, " 
+        << totalWorldMs / elapsed.count() << "x concurrency\n";
+
+    for (SandStorm* world : worlds) delete world;
+}
+
+//Worker loop, results only depend on the job so they don't change with the thread count
+void BatchRunner::RunWorker(SandStorm* world)
+{
+    for (int jobIndex = nextJob++; jobIndex < static_cast<int>(jobs.size()); jobIndex = nextJob++)
+    {
+        const BatchJob& job = jobs[jobIndex];
+        BatchResult& result = results[jobIndex];
+
+        world->SetSeed(job.seed);
+        {
+            std::lock_guard<std::mutex> lock(importMutex); //raylib image loading isn't thread safe
+            world->imageImporter->ImportImage(job.sceneIndex);
+        }
+        result.sceneName = world->imageImporter->GetImageName(job.sceneIndex);
+
+        auto startTime = std::chrono::steady_clock::now();
+        for (int tick = 0; tick < ticksPerWorld; tick++)
+        {
+            world->Step();
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+
+        result.finalHash = world->stateHasher->currentHash;
+        result.milliseconds = elapsed.count();
+    }
+}
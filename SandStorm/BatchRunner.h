@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SandStorm.h"
+
+class BatchRunner
+{
+public:
+	BatchRunner(int threadCount = 0);
+	void Run(int worldCount);
+
+	typedef struct BatchJob {
+		int sceneIndex;
+		unsigned int seed;
+	};
+
+	typedef struct BatchResult {
+		std::string sceneName;
+		uint64_t finalHash = 0;
+		double milliseconds = 0;
+	};
+
+	std::vector<BatchJob> jobs;
+	std::vector<BatchResult> results;
+
+	SandStorm::UpdateEngine updateEngine = SandStorm::UpdateEngine::CELLULAR;
+	unsigned int firstSeed = 1;
+	int ticksPerWorld = 600;
+	int threadCount = 0;
+
+private:
+	void RunWorker(SandStorm* world);
+
+	std::atomic<int> nextJob = 0;
+	std::mutex importMutex;
+};
@@ -0,0 +1,185 @@
+#include "BitplaneEngine.h"
+
+#include <bit>
+
+BitplaneEngine::BitplaneEngine(SandStorm* sandStorm, int width, int height)
+{
+    this->sandStorm = sandStorm;
+    this->width = width;
+    this->height = height;
+
+    wordsPerRow = width / 64;
+    sand.resize(wordsPerRow * height);
+    occupied.resize(wordsPerRow * height);
+    solid.resize(wordsPerRow * height);
+    inert.resize(wordsPerRow * height);
+
+    occupiedBelow.resize(wordsPerRow);
+    fall.resize(wordsPerRow);
+    slideLeft.resize(wordsPerRow);
+    slideRight.resize(wordsPerRow);
+    targetsLeft.resize(wordsPerRow);
+    targetsRight.resize(wordsPerRow);
+    movedLeft.resize(wordsPerRow);
+    movedRight.resize(wordsPerRow);
+    genericSand.resize(wordsPerRow);
+}
+
+//Resolve falling and diagonal sliding for a whole row of sand, 64 cells at a time.
+//genericMask receives all cells of the row that still need the generic SandStorm::UpdateCell path.
+//Sand only moves down and rows are swept bottom-up, so sand in this row can't carry this tick's update stamp yet
+void BitplaneEngine::UpdateSandRow(int y, uint64_t tickSeed, bool sandActive, uint64_t* genericMask)
+{
+    const int row = y * wordsPerRow;
+    const int rowBelow = row + wordsPerRow;
+
+    if (!sandActive) //sand isn't scheduled this tick, it stays in the mask so awake sand gets queued and kept awake for the next tick
+    {
+        for (int w = 0; w < wordsPerRow; w++)
+        {
+            genericMask[w] = occupied[row + w] & ~inert[row + w];
+        }
+        return;
+    }
+
+    std::copy(occupied.begin() + rowBelow, occupied.begin() + rowBelow + wordsPerRow, occupiedBelow.begin());
+    std::fill(movedLeft.begin(), movedLeft.end(), 0);
+    std::fill(movedRight.begin(), movedRight.end(), 0);
+
+    for (int w = 0; w < wordsPerRow; w++)
+    {
+        uint64_t interactBelow = GetInteractive(rowBelow + w); //water, smoke, fire and lava
+
+        //diagonal neighbours below, shifted so bit x holds the cell at x - 1 / x + 1
+        uint64_t interactBelowLeft = (interactBelow << 1) | (w > 0 ? GetInteractive(rowBelow + w - 1) >> 63 : 0);
+        uint64_t interactBelowRight = (interactBelow >> 1) | (w + 1 < wordsPerRow ? GetInteractive(rowBelow + w + 1) << 63 : 0);
+
+        uint64_t cells = sand[row + w];
+        fall[w] = cells & ~occupiedBelow[w];
+
+        //sand that can interact with the cell below or one of the diagonals falls back to the generic path
+        uint64_t blocked = cells & ~fall[w];
+        genericSand[w] = blocked & (interactBelow | interactBelowLeft | interactBelowRight);
+
+        uint64_t sliding = blocked & ~genericSand[w];
+        uint64_t randomSide = StateHasher::Mix(tickSeed ^ static_cast<uint64_t>(row + w)); //one random side per cell, 1 = left
+        slideLeft[w] = sliding & randomSide;
+        slideRight[w] = sliding & ~randomSide;
+
+        occupiedBelow[w] |= fall[w]; //falling cells claim their target first
+    }
+
+    //slide targets in the row below, left slides move bit x to x - 1, right slides move bit x to x + 1
+    for (int w = 0; w < wordsPerRow; w++)
+    {
+        targetsLeft[w] = (slideLeft[w] >> 1) | (w + 1 < wordsPerRow ? slideLeft[w + 1] << 63 : 0);
+        targetsRight[w] = (slideRight[w] << 1) | (w > 0 ? slideRight[w - 1] >> 63 : 0);
+    }
+
+    for (int w = 0; w < wordsPerRow; w++)
+    {
+        uint64_t freeLeft = targetsLeft[w] & ~occupiedBelow[w];
+        uint64_t freeRight = targetsRight[w] & ~occupiedBelow[w];
+
+        //a free cell both diagonals slide into goes to a random side, so piles don't drift in one direction
+        uint64_t contested = freeLeft & freeRight;
+        uint64_t leftWins = StateHasher::Mix(tickSeed ^ ~static_cast<uint64_t>(rowBelow + w));
+
+        uint64_t acceptedLeft = freeLeft & ~(contested & ~leftWins);
+        uint64_t acceptedRight = freeRight & ~(contested & leftWins);
+
+        movedLeft[w] |= acceptedLeft << 1;
+        if (w + 1 < wordsPerRow) movedLeft[w + 1] |= acceptedLeft >> 63;
+
+        movedRight[w] |= acceptedRight >> 1;
+        if (w > 0) movedRight[w - 1] |= acceptedRight << 63;
+    }
+
+    MoveSand(y, fall.data(), 0);
+    MoveSand(y, movedLeft.data(), -1);
+    MoveSand(y, movedRight.data(), 1);
+
+    //everything that is left in this row and isn't resting sand or an inert cell still needs a generic update
+    for (int w = 0; w < wordsPerRow; w++)
+    {
+        genericMask[w] = (occupied[row + w] & ~inert[row + w] & ~sand[row + w]) | genericSand[w];
+    }
+}
+
+//Move all sand cells marked in the given row mask one row down (and xOffset to the side)
+void BitplaneEngine::MoveSand(int y, const uint64_t* moved, int xOffset)
+{
+    for (int w = 0; w < wordsPerRow; w++)
+    {
+        uint64_t bits = moved[w];
+        while (bits != 0)
+        {
+            int x = w * 64 + std::countr_zero(bits);
+            int index = x + width * y;
+            sandStorm->MoveCell(index, index + width + xOffset);
+
+            bits &= bits - 1;
+        }
+    }
+}
+
+//Returns the cells of a word that sand can interact with
+uint64_t BitplaneEngine::GetInteractive(int word)
+{
+    return occupied[word] & ~solid[word];
+}
+
+//Keep the bitplanes in sync with the grid
+void BitplaneEngine::OnCellChanged(int index, unsigned char oldType, unsigned char newType)
+{
+    if (oldType == newType)
+        return;
+
+    SetBit(sand, index, newType == Element::Elements::SAND);
+    SetBit(occupied, index, newType != Element::Elements::UNOCCUPIED);
+    SetBit(solid, index, IsSolidForSand(newType));
+    SetBit(inert, index, newType == Element::Elements::WALL || newType == Element::Elements::OBSIDIAN);
+}
+
+//Recreate all bitplanes from the grid (used after another engine changed the grid)
+void BitplaneEngine::Rebuild(SandStorm::CellInfo* map)
+{
+    Reset();
+    for (int i = 0; i < width * height; i++)
+    {
+        OnCellChanged(i, Element::Elements::UNOCCUPIED, map[i].type);
+    }
+}
+
+//Clear all bitplanes
+void BitplaneEngine::Reset()
+{
+    std::fill(sand.begin(), sand.end(), 0);
+    std::fill(occupied.begin(), occupied.end(), 0);
+    std::fill(solid.begin(), solid.end(), 0);
+    std::fill(inert.begin(), inert.end(), 0);
+}
+
+//Helper method for setting a single bit in a bitplane
+void BitplaneEngine::SetBit(std::vector<uint64_t>& plane, int index, bool state)
+{
+    uint64_t mask = 1ull << (index % 64);
+    if (state) plane[index / 64] |= mask;
+    else plane[index / 64] &= ~mask;
+}
+
+//Returns true for cells sand can neither move into nor interact with
+bool BitplaneEngine::IsSolidForSand(unsigned char type)
+{
+    switch (type)
+    {
+        case Element::Elements::SAND:
+        case Element::Elements::WALL:
+        case Element::Elements::OBSIDIAN:
+        case Element::Elements::WOOD:
+        case Element::Elements::STATIONARY_FIRE:
+            return true;
+        default:
+            return false;
+    }
+}
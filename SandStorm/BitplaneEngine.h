@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "SandStorm.h"
+
+class BitplaneEngine
+{
+public:
+	BitplaneEngine(SandStorm* sandStorm, int width, int height);
+
+	void UpdateSandRow(int y, uint64_t tickSeed, bool sandActive, uint64_t* genericMask);
+
+	void OnCellChanged(int index, unsigned char oldType, unsigned char newType);
+	void Rebuild(SandStorm::CellInfo* map);
+	void Reset();
+
+	int wordsPerRow = 0;
+
+private:
+	void SetBit(std::vector<uint64_t>& plane, int index, bool state);
+	void MoveSand(int y, const uint64_t* moved, int xOffset);
+	uint64_t GetInteractive(int word);
+
+	static bool IsSolidForSand(unsigned char type);
+
+	SandStorm* sandStorm = nullptr;
+	int width = 0;
+	int height = 0;
+
+	//one bit per cell, 64 cells per word, rows are wordsPerRow words long
+	std::vector<uint64_t> sand;
+	std::vector<uint64_t> occupied;
+	std::vector<uint64_t> solid; //cells sand can't move into or interact with
+	std::vector<uint64_t> inert; //cells that never update (wall/obsidian)
+
+	//scratch rows for UpdateSandRow
+	std::vector<uint64_t> occupiedBelow;
+	std::vector<uint64_t> fall;
+	std::vector<uint64_t> slideLeft;
+	std::vector<uint64_t> slideRight;
+	std::vector<uint64_t> targetsLeft;
+	std::vector<uint64_t> targetsRight;
+	std::vector<uint64_t> movedLeft;
+	std::vector<uint64_t> movedRight;
+	std::vector<uint64_t> genericSand;
+};
@@ -0,0 +1,281 @@
+#include "ChunkMap.h"
+
+#include <algorithm>
+
+ChunkMap::ChunkMap(SandStorm::CellInfo* map, int width, int height, int chunkSize)
+    : dirtyChunks(((width + chunkSize - 1) / chunkSize) * ((height + chunkSize - 1) / chunkSize))
+{
+    this->map = map;
+    this->width = width;
+    this->height = height;
+    this->chunkSize = chunkSize;
+
+    chunksX = (width + chunkSize - 1) / chunkSize;
+    chunksY = (height + chunkSize - 1) / chunkSize;
+    chunks.resize(chunksX * chunksY);
+
+    Reset();
+}
+
+//Count cells of an element inside an area, whole chunks are answered from their summary
+int ChunkMap::CountElement(Rectangle area, Element::Elements element)
+{
+    int minX, minY, maxX, maxY;
+    if (!ClampArea(area, minX, minY, maxX, maxY))
+        return 0;
+
+    int count = 0;
+    for (int chunkY = minY / chunkSize; chunkY <= maxY / chunkSize; chunkY++)
+    {
+        for (int chunkX = minX / chunkSize; chunkX <= maxX / chunkSize; chunkX++)
+        {
+            const ChunkInfo& chunk = chunks[chunkX + chunksX * chunkY];
+            if (chunk.counts[element] == 0)
+                continue;
+
+            int chunkMinX = chunkX * chunkSize;
+            int chunkMinY = chunkY * chunkSize;
+            int chunkMaxX = std::min(chunkMinX + chunkSize, width) - 1;
+            int chunkMaxY = std::min(chunkMinY + chunkSize, height) - 1;
+
+            if (minX <= chunkMinX && minY <= chunkMinY && maxX >= chunkMaxX && maxY >= chunkMaxY) //chunk lies completely inside the area
+            {
+                count += chunk.counts[element];
+                continue;
+            }
+
+            int overlapWidth = std::min(maxX, chunkMaxX) - std::max(minX, chunkMinX) + 1;
+            int overlapHeight = std::min(maxY, chunkMaxY) - std::max(minY, chunkMinY) + 1;
+            if (chunk.counts[element] == (chunkMaxX - chunkMinX + 1) * (chunkMaxY - chunkMinY + 1)) //chunk only contains this element
+            {
+                count += overlapWidth * overlapHeight;
+                continue;
+            }
+
+            //drill down, only the part of the area that overlaps the element bounds needs to be scanned
+            const BoundingBox& bounds = chunk.bounds[element];
+            for (int y = std::max(minY, bounds.minY); y <= std::min(maxY, bounds.maxY); y++)
+            {
+                for (int x = std::max(minX, bounds.minX); x <= std::min(maxX, bounds.maxX); x++)
+                {
+                    if (map[x + width * y].type == element)
+                        count++;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+//Returns the amount of cells of an element in the whole grid
+int ChunkMap::GetTotalCount(Element::Elements element)
+{
+    return totalCounts[element];
+}
+
+//Checks if an area doesn't contain any cells
+bool ChunkMap::IsEmpty(Rectangle area)
+{
+    int minX, minY, maxX, maxY;
+    if (!ClampArea(area, minX, minY, maxX, maxY))
+        return true;
+
+    return CountElement(area, Element::Elements::UNOCCUPIED) == (maxX - minX + 1) * (maxY - minY + 1);
+}
+
+//Count cells of an element inside a circle (same footprint as the brush), chunks inside the circle are answered from their summary
+int ChunkMap::CountElementInCircle(Vector2 center, int radius, Element::Elements element)
+{
+    int centerX = static_cast<int>(center.x);
+    int centerY = static_cast<int>(center.y);
+
+    int minX, minY, maxX, maxY;
+    if (!ClampArea(Rectangle(centerX - radius, centerY - radius, radius * 2 + 1, radius * 2 + 1), minX, minY, maxX, maxY))
+        return 0;
+
+    int radiusSquared = radius * radius;
+    auto isInside = [&](int x, int y) { return (x - centerX) * (x - centerX) + (y - centerY) * (y - centerY) <= radiusSquared; };
+
+    int count = 0;
+    for (int chunkY = minY / chunkSize; chunkY <= maxY / chunkSize; chunkY++)
+    {
+        for (int chunkX = minX / chunkSize; chunkX <= maxX / chunkSize; chunkX++)
+        {
+            const ChunkInfo& chunk = chunks[chunkX + chunksX * chunkY];
+            if (chunk.counts[element] == 0)
+                continue;
+
+            int chunkMinX = chunkX * chunkSize;
+            int chunkMinY = chunkY * chunkSize;
+            int chunkMaxX = std::min(chunkMinX + chunkSize, width) - 1;
+            int chunkMaxY = std::min(chunkMinY + chunkSize, height) - 1;
+
+            //the circle is convex, so a chunk with all corners inside lies completely inside it
+            if (isInside(chunkMinX, chunkMinY) && isInside(chunkMaxX, chunkMinY) && isInside(chunkMinX, chunkMaxY) && isInside(chunkMaxX, chunkMaxY))
+            {
+                count += chunk.counts[element];
+                continue;
+            }
+
+            //drill down, only the part of the circle that overlaps the element bounds needs to be scanned
+            const BoundingBox& bounds = chunk.bounds[element];
+            for (int y = std::max(minY, bounds.minY); y <= std::min(maxY, bounds.maxY); y++)
+            {
+                for (int x = std::max(minX, bounds.minX); x <= std::min(maxX, bounds.maxX); x++)
+                {
+                    if (map[x + width * y].type == element && isInside(x, y))
+                        count++;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+//Checks if a circle doesn't contain any cells
+bool ChunkMap::IsCircleEmpty(Vector2 center, int radius)
+{
+    for (int element = 1; element < Element::ELEMENT_COUNT; element++)
+    {
+        if (CountElementInCircle(center, radius, static_cast<Element::Elements>(element)) > 0)
+            return false;
+    }
+    return true;
+}
+
+//Find the closest cell of an element, chunks are visited nearest first and skipped once they can't contain a closer cell
+bool ChunkMap::FindNearest(Vector2 position, Element::Elements element, Vector2& result)
+{
+    std::vector<std::pair<float, int>> candidates; //(lowest possible squared distance, chunk)
+    for (int chunk = 0; chunk < static_cast<int>(chunks.size()); chunk++)
+    {
+        if (chunks[chunk].counts[element] == 0)
+            continue;
+
+        const BoundingBox& bounds = chunks[chunk].bounds[element];
+        float dx = std::max({ bounds.minX - position.x, 0.0f, position.x - bounds.maxX });
+        float dy = std::max({ bounds.minY - position.y, 0.0f, position.y - bounds.maxY });
+        candidates.push_back({ dx * dx + dy * dy, chunk });
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    float closestDistance = FLT_MAX;
+    for (const auto& [lowestDistance, chunk] : candidates)
+    {
+        if (lowestDistance >= closestDistance)
+            break;
+
+        const BoundingBox& bounds = chunks[chunk].bounds[element];
+        for (int y = bounds.minY; y <= bounds.maxY; y++)
+        {
+            for (int x = bounds.minX; x <= bounds.maxX; x++)
+            {
+                if (map[x + width * y].type != element)
+                    continue;
+
+                float distance = (x - position.x) * (x - position.x) + (y - position.y) * (y - position.y);
+                if (distance < closestDistance)
+                {
+                    closestDistance = distance;
+                    result = Vector2(x, y);
+                }
+            }
+        }
+    }
+    return closestDistance != FLT_MAX;
+}
+
+//Keep chunk summaries in sync with the grid
+void ChunkMap::OnCellChanged(int index, unsigned char oldType, unsigned char newType)
+{
+    if (oldType == newType)
+        return;
+
+    int x = index % width;
+    int y = index / width;
+    ChunkInfo& chunk = chunks[(x / chunkSize) + chunksX * (y / chunkSize)];
+
+    chunk.counts[oldType]--;
+    chunk.counts[newType]++;
+    totalCounts[oldType]--;
+    totalCounts[newType]++;
+
+    if (chunk.counts[oldType] == 0) //bounds can only shrink when an element leaves the chunk completely
+        chunk.bounds[oldType] = BoundingBox();
+
+    GrowBounds(chunk.bounds[newType], x, y);
+}
+
+//Mark the chunk of a cell as changed, safe to call from worker threads
+void ChunkMap::MarkDirty(int index)
+{
+    int chunk = ((index % width) / chunkSize) + chunksX * ((index / width) / chunkSize);
+    dirtyChunks[chunk].store(true, std::memory_order_relaxed);
+}
+
+//Recount all chunks that were marked dirty
+void ChunkMap::RefreshDirtyChunks()
+{
+    for (int chunk = 0; chunk < static_cast<int>(chunks.size()); chunk++)
+    {
+        if (dirtyChunks[chunk].exchange(false, std::memory_order_relaxed))
+            RecountChunk(chunk);
+    }
+}
+
+//Clear all summaries (all cells unoccupied)
+void ChunkMap::Reset()
+{
+    std::fill(std::begin(totalCounts), std::end(totalCounts), 0);
+    for (int chunk = 0; chunk < static_cast<int>(chunks.size()); chunk++)
+    {
+        chunks[chunk] = ChunkInfo();
+        dirtyChunks[chunk] = true; //recount on next refresh, also sets up the unoccupied counts
+    }
+    RefreshDirtyChunks();
+}
+
+//Recalculate counts and bounds of a single chunk from the grid
+void ChunkMap::RecountChunk(int chunk)
+{
+    ChunkInfo& info = chunks[chunk];
+    for (int element = 0; element < Element::ELEMENT_COUNT; element++)
+        totalCounts[element] -= info.counts[element];
+
+    info = ChunkInfo();
+
+    int chunkMinX = (chunk % chunksX) * chunkSize;
+    int chunkMinY = (chunk / chunksX) * chunkSize;
+    for (int y = chunkMinY; y < std::min(chunkMinY + chunkSize, height); y++)
+    {
+        for (int x = chunkMinX; x < std::min(chunkMinX + chunkSize, width); x++)
+        {
+            unsigned char type = map[x + width * y].type;
+            info.counts[type]++;
+            GrowBounds(info.bounds[type], x, y);
+        }
+    }
+
+    for (int element = 0; element < Element::ELEMENT_COUNT; element++)
+        totalCounts[element] += info.counts[element];
+}
+
+//Helper method for growing a bounding box so it contains a position
+void ChunkMap::GrowBounds(BoundingBox& bounds, int x, int y)
+{
+    bounds.minX = std::min(bounds.minX, x);
+    bounds.minY = std::min(bounds.minY, y);
+    bounds.maxX = std::max(bounds.maxX, x);
+    bounds.maxY = std::max(bounds.maxY, y);
+}
+
+//Clamp an area to the grid, returns false if nothing is left
+bool ChunkMap::ClampArea(Rectangle area, int& minX, int& minY, int& maxX, int& maxY)
+{
+    minX = std::max(static_cast<int>(area.x), 0);
+    minY = std::max(static_cast<int>(area.y), 0);
+    maxX = std::min(static_cast<int>(area.x + area.width) - 1, width - 1);
+    maxY = std::min(static_cast<int>(area.y + area.height) - 1, height - 1);
+
+    return minX <= maxX && minY <= maxY;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <climits>
+#include <cfloat>
+#include <vector>
+
+#include "SandStorm.h"
+
+class ChunkMap
+{
+public:
+	ChunkMap(SandStorm::CellInfo* map, int width, int height, int chunkSize = 32);
+
+	int CountElement(Rectangle area, Element::Elements element);
+	int GetTotalCount(Element::Elements element);
+	bool IsEmpty(Rectangle area);
+	int CountElementInCircle(Vector2 center, int radius, Element::Elements element);
+	bool IsCircleEmpty(Vector2 center, int radius);
+	bool FindNearest(Vector2 position, Element::Elements element, Vector2& result);
+
+	void OnCellChanged(int index, unsigned char oldType, unsigned char newType);
+	void MarkDirty(int index);
+	void RefreshDirtyChunks();
+	void Reset();
+
+private:
+	typedef struct BoundingBox {
+		int minX = INT_MAX;
+		int minY = INT_MAX;
+		int maxX = -1;
+		int maxY = -1;
+	};
+
+	typedef struct ChunkInfo {
+		int counts[Element::ELEMENT_COUNT] = {};
+		BoundingBox bounds[Element::ELEMENT_COUNT]; //conservative, only grows until the element disappears from the chunk
+	};
+
+	void RecountChunk(int chunk);
+	void GrowBounds(BoundingBox& bounds, int x, int y);
+	bool ClampArea(Rectangle area, int& minX, int& minY, int& maxX, int& maxY);
+
+	SandStorm::CellInfo* map = nullptr;
+	int width = 0;
+	int height = 0;
+	int chunkSize = 0;
+	int chunksX = 0;
+	int chunksY = 0;
+
+	std::vector<ChunkInfo> chunks;
+	std::vector<std::atomic<bool>> dirtyChunks; //chunks changed by worker threads, recounted on the main thread
+	int totalCounts[Element::ELEMENT_COUNT] = {};
+};
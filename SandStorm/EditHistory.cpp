@@ -0,0 +1,217 @@
+#include "EditHistory.h"
+
+#include <algorithm>
+#include <climits>
+
+EditHistory::EditHistory(SandStorm* sandStorm, int cellCount)
+{
+    this->sandStorm = sandStorm;
+    this->cellCount = cellCount;
+    recordedSlot.resize(cellCount, -1);
+}
+
+//Start recording a brush stroke
+void EditHistory::BeginEdit()
+{
+    if (isRecording || gridEditDepth > 0)
+        return;
+
+    isRecording = true;
+    manipulatorsBefore = sandStorm->autoManipulators;
+}
+
+//Record a single cell change, the first before and the last after value of a cell are kept
+void EditHistory::RecordCell(int index, unsigned char before, unsigned char after)
+{
+    if (!isRecording || gridEditDepth > 0)
+        return;
+
+    if (recordedSlot[index] < 0)
+    {
+        recordedSlot[index] = static_cast<int>(recordedCells.size());
+        recordedCells.push_back(CellRun(index, 1, before, after));
+    }
+    else
+    {
+        recordedCells[recordedSlot[index]].after = after;
+    }
+}
+
+//Stop recording a brush stroke and store it as a sparse run length encoded diff
+void EditHistory::EndEdit()
+{
+    if (!isRecording)
+        return;
+
+    isRecording = false;
+
+    std::sort(recordedCells.begin(), recordedCells.end(), [](const CellRun& a, const CellRun& b) { return a.start < b.start; });
+
+    Edit edit;
+    for (const auto& cell : recordedCells)
+    {
+        recordedSlot[cell.start] = -1;
+        if (cell.before == cell.after)
+            continue;
+
+        //extend the previous run if this cell directly follows it with the same change
+        CellRun* lastRun = edit.runs.empty() ? nullptr : &edit.runs.back();
+        if (lastRun && lastRun->start + lastRun->length == cell.start && lastRun->before == cell.before && lastRun->after == cell.after && lastRun->length < USHRT_MAX)
+            lastRun->length++;
+        else
+            edit.runs.push_back(cell);
+    }
+    recordedCells.clear();
+
+    edit.changesManipulators = manipulatorsBefore.size() != sandStorm->autoManipulators.size();
+    if (edit.changesManipulators)
+    {
+        edit.manipulatorsBefore = manipulatorsBefore;
+        edit.manipulatorsAfter = sandStorm->autoManipulators;
+    }
+
+    if (!edit.runs.empty() || edit.changesManipulators)
+        PushEdit(edit);
+}
+
+//Start recording an edit that can change the whole grid (reset/image import), these are stored as keyframes
+void EditHistory::BeginGridEdit()
+{
+    if (gridEditDepth++ > 0) //nested grid edits (import resets the sim) are part of the outer edit
+        return;
+
+    EndEdit(); //a running stroke ends here
+
+    EncodeKeyframe(gridBefore);
+    manipulatorsBefore = sandStorm->autoManipulators;
+}
+
+//Stop recording a grid edit, the grid is stored as a keyframe before and after the edit.
+//Undoing it restores the whole grid, strokes only revert their own cells since the sim keeps running in between
+void EditHistory::EndGridEdit()
+{
+    if (--gridEditDepth > 0)
+        return;
+
+    Edit edit;
+    edit.keyframeBefore = std::move(gridBefore);
+    EncodeKeyframe(edit.keyframeAfter);
+    gridBefore.clear();
+
+    edit.changesManipulators = true;
+    edit.manipulatorsBefore = manipulatorsBefore;
+    edit.manipulatorsAfter = sandStorm->autoManipulators;
+
+    PushEdit(edit);
+}
+
+//Revert the last edit, returns false if there is nothing to undo
+bool EditHistory::Undo()
+{
+    EndEdit();
+    if (undoEdits.empty())
+        return false;
+
+    ApplyEdit(undoEdits.back(), true);
+
+    memoryUsage -= undoEdits.back().memoryUsage;
+    redoEdits.push_back(std::move(undoEdits.back()));
+    undoEdits.pop_back();
+    return true;
+}
+
+//Reapply the last undone edit, returns false if there is nothing to redo
+bool EditHistory::Redo()
+{
+    EndEdit();
+    if (redoEdits.empty())
+        return false;
+
+    ApplyEdit(redoEdits.back(), false);
+
+    memoryUsage += redoEdits.back().memoryUsage;
+    undoEdits.push_back(std::move(redoEdits.back()));
+    redoEdits.pop_back();
+    return true;
+}
+
+//Drop all recorded edits
+void EditHistory::Clear()
+{
+    undoEdits.clear();
+    redoEdits.clear();
+    memoryUsage = 0;
+}
+
+//Returns the memory used by all undoable edits
+size_t EditHistory::GetMemoryUsage()
+{
+    return memoryUsage;
+}
+
+//Add a finished edit, drops the oldest edits when the history gets too big
+void EditHistory::PushEdit(Edit& edit)
+{
+    edit.memoryUsage = sizeof(Edit) + edit.runs.size() * sizeof(CellRun) + (edit.keyframeBefore.size() + edit.keyframeAfter.size()) * sizeof(TypeRun) + (edit.manipulatorsBefore.size() + edit.manipulatorsAfter.size()) * sizeof(SandStorm::AutoCellManipulator);
+
+    memoryUsage += edit.memoryUsage;
+    undoEdits.push_back(std::move(edit));
+    redoEdits.clear();
+
+    while (memoryUsage > memoryLimit && undoEdits.size() > 1)
+    {
+        memoryUsage -= undoEdits.front().memoryUsage;
+        undoEdits.pop_front();
+    }
+}
+
+//Apply an edit in either direction, cells that were changed again since (by the sim or other edits) are left alone
+void EditHistory::ApplyEdit(const Edit& edit, bool undo)
+{
+    for (const auto& run : edit.runs)
+    {
+        unsigned char from = undo ? run.after : run.before;
+        unsigned char to = undo ? run.before : run.after;
+
+        for (int index = run.start; index < run.start + run.length; index++)
+        {
+            if (sandStorm->GetCellType(index) == from)
+                sandStorm->SetCell(index, static_cast<Element::Elements>(to), false);
+        }
+    }
+
+    if (!edit.keyframeBefore.empty())
+        RestoreKeyframe(undo ? edit.keyframeBefore : edit.keyframeAfter);
+
+    if (edit.changesManipulators)
+        sandStorm->autoManipulators = undo ? edit.manipulatorsBefore : edit.manipulatorsAfter;
+}
+
+//Run length encode the cell types of the whole grid
+void EditHistory::EncodeKeyframe(std::vector<TypeRun>& keyframe)
+{
+    keyframe.clear();
+    for (int i = 0; i < cellCount; i++)
+    {
+        unsigned char type = sandStorm->GetCellType(i);
+
+        TypeRun* lastRun = keyframe.empty() ? nullptr : &keyframe.back();
+        if (lastRun && lastRun->type == type && lastRun->length < USHRT_MAX)
+            lastRun->length++;
+        else
+            keyframe.push_back(TypeRun(i, 1, type));
+    }
+}
+
+//Set every cell that differs from the keyframe back to its keyframe type
+void EditHistory::RestoreKeyframe(const std::vector<TypeRun>& keyframe)
+{
+    for (const auto& run : keyframe)
+    {
+        for (int index = run.start; index < run.start + run.length; index++)
+        {
+            if (sandStorm->GetCellType(index) != run.type)
+                sandStorm->SetCell(index, static_cast<Element::Elements>(run.type), false);
+        }
+    }
+}
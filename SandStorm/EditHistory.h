@@ -0,0 +1,70 @@
+#pragma once
+#include <deque>
+#include <vector>
+
+#include "SandStorm.h"
+
+class EditHistory
+{
+public:
+	EditHistory(SandStorm* sandStorm, int cellCount);
+
+	void BeginEdit();
+	void RecordCell(int index, unsigned char before, unsigned char after);
+	void EndEdit();
+
+	void BeginGridEdit();
+	void EndGridEdit();
+
+	bool Undo();
+	bool Redo();
+	void Clear();
+
+	size_t GetMemoryUsage();
+
+	size_t memoryLimit = 8 * 1024 * 1024; //oldest edits get dropped when the history grows beyond this
+
+private:
+	typedef struct CellRun {
+		int start;
+		unsigned short length;
+		unsigned char before;
+		unsigned char after;
+	};
+
+	typedef struct TypeRun {
+		int start;
+		unsigned short length;
+		unsigned char type;
+	};
+
+	typedef struct Edit {
+		std::vector<CellRun> runs; //sparse run length encoded diff, only cells changed by the edit
+		std::vector<TypeRun> keyframeBefore; //run length encoded snapshot of the whole grid, only for grid edits
+		std::vector<TypeRun> keyframeAfter;
+		bool changesManipulators = false;
+		std::vector<SandStorm::AutoCellManipulator> manipulatorsBefore;
+		std::vector<SandStorm::AutoCellManipulator> manipulatorsAfter;
+		size_t memoryUsage = 0;
+	};
+
+	void PushEdit(Edit& edit);
+	void ApplyEdit(const Edit& edit, bool undo);
+	void EncodeKeyframe(std::vector<TypeRun>& keyframe);
+	void RestoreKeyframe(const std::vector<TypeRun>& keyframe);
+
+	SandStorm* sandStorm = nullptr;
+	int cellCount = 0;
+
+	std::deque<Edit> undoEdits; //used as ring buffer, bounded by memoryLimit
+	std::deque<Edit> redoEdits;
+	size_t memoryUsage = 0;
+
+	//edit that is currently being recorded
+	bool isRecording = false;
+	int gridEditDepth = 0;
+	std::vector<int> recordedSlot; //per cell index into recordedCells, -1 when untouched
+	std::vector<CellRun> recordedCells;
+	std::vector<TypeRun> gridBefore;
+	std::vector<SandStorm::AutoCellManipulator> manipulatorsBefore;
+};
@@ -15,5 +15,7 @@ public:
 		STATIONARY_FIRE = 8,
 		FIRE = 9
 	};
+
+	static constexpr int ELEMENT_COUNT = 10;
 };
 
@@ -1,38 +1,29 @@
 #include "ElementRules.h"
 
-float aplhaRandomness = 200;
-
-ElementRules::ElementRules()
+ElementRules::ElementRules(RandomGenerator* random)
 {
+    this->random = random;
+
     //Adding new cells steps:
     //  1. Add a new element type (Elements::Element)
     //  2. Add a hotkey check for switching to new cell
     //  3. Add string -> enum conversion for UI label
-    //  4. Add rules for new cell
+    //  4. Add rules for new cell (ElementRules.h)
     //  5. Add color for new cell
-    //  6. Bind element to its ruleset
-    //  (optional) 7. Bind raw pixel color to cell element for imageimporter
-    //  (optional) 8. Add custom cell behaviour to for interaction.
-
-    // Initialize rule sets
-    sandRules =  { DOWN, SIDE_DOWN };
-    waterRules = { DOWN, SIDE, SIDE_DOWN };
-    smokeRules = { UP, SIDE_UP, SIDE };
-    lavaRules =  { DOWN, SIDE, SIDE_DOWN };
-    fireRules =  { UP, SIDE_UP, SIDE };
-    
-    woodRules =  { STAY };
-    stationaryFireRules =  { STAY };
+    //  6. Bind element to its ruleset (getRuleSet and GetRules)
+    //  7. Add the element to the kernel dispatch (SandStorm::UpdateCell and SandStorm::UpdateActiveCells)
+    //  (optional) 8. Bind raw pixel color to cell element for imageimporter
+    //  (optional) 9. Add custom cell behaviour to SandStorm::Interact (and SandStorm::CanAct) for interaction.
 
     // Initialize getRuleSet map
     getRuleSet = {
-        { Element::Elements::SAND,                        sandRules  },
-        { Element::Elements::WATER,                       waterRules },
-        { Element::Elements::SMOKE,                       smokeRules },
-        { Element::Elements::LAVA,                        lavaRules  },
-        { Element::Elements::WOOD,                        woodRules  },
-        { Element::Elements::FIRE,                        fireRules  },
-        { Element::Elements::STATIONARY_FIRE,   stationaryFireRules  }
+        { Element::Elements::SAND,            { sandRules.begin(), sandRules.end() }                     },
+        { Element::Elements::WATER,           { waterRules.begin(), waterRules.end() }                   },
+        { Element::Elements::SMOKE,           { smokeRules.begin(), smokeRules.end() }                   },
+        { Element::Elements::LAVA,            { lavaRules.begin(), lavaRules.end() }                     },
+        { Element::Elements::WOOD,            { woodRules.begin(), woodRules.end() }                     },
+        { Element::Elements::FIRE,            { fireRules.begin(), fireRules.end() }                     },
+        { Element::Elements::STATIONARY_FIRE, { stationaryFireRules.begin(), stationaryFireRules.end() } }
     };
 
     // Initialize cell base color values
@@ -44,12 +35,6 @@ ElementRules::ElementRules()
         { Element::Elements::LAVA,       Color(255, 77, 28, 255)   },
         { Element::Elements::WOOD,       Color(130, 65, 0, 255)    },
     };
-
-    // Initialize ruleValues map
-    ruleValues = {
-        { UP,         Vector2(0, -1) },
-        { DOWN,       Vector2(0, 1)  },
-    };
 }
 
 //Returns a randomized color value based on input element
@@ -61,7 +46,7 @@ Color ElementRules::GetCellColor(Element::Elements element)
     bool isFireElement = element == Element::Elements::STATIONARY_FIRE || element == Element::Elements::FIRE;
     if (isFireElement) //special colors for fire
     {
-        int randColor = GetRandomValue(1, 5);
+        int randColor = random->GetValue(1, 5);
         switch (randColor)
         {
             case 1: return Color(156, 43, 17, 255);
@@ -73,7 +58,33 @@ Color ElementRules::GetCellColor(Element::Elements element)
     }
     
     Color baseColor = cellColorValues[element];
-    int randAlpha = GetRandomValue(aplhaRandomness, 255); // randomize alpha
+    int randAlpha = random->GetValue(alphaRandomness, 255); // randomize alpha
     
+    return Color(baseColor.r, baseColor.g, baseColor.b, randAlpha);
+}
+
+//Same as GetCellColor but randomized from the given noise value, safe to call from worker threads
+Color ElementRules::GetCellColor(Element::Elements element, uint64_t noise)
+{
+    if (element == Element::Elements::UNOCCUPIED) return BLACK;
+    if (element == Element::Elements::OBSIDIAN)   return BLACK;
+
+    bool isFireElement = element == Element::Elements::STATIONARY_FIRE || element == Element::Elements::FIRE;
+    if (isFireElement) //special colors for fire
+    {
+        switch (noise % 5)
+        {
+            case 0: return Color(156, 43, 17, 255);
+            case 1: return Color(255, 106, 0, 255);
+            case 2: return Color(127, 0, 0, 255);
+            case 3: return Color(255, 151, 0, 255);
+            case 4: return Color(127, 51, 0, 255);
+        }
+    }
+
+    Color baseColor = cellColorValues.at(element);
+    int minAlpha = static_cast<int>(alphaRandomness);
+    int randAlpha = minAlpha + static_cast<int>(noise % (256 - minAlpha)); // randomize alpha
+
     return Color(baseColor.r, baseColor.g, baseColor.b, randAlpha);
 }
\ No newline at end of file
@@ -2,14 +2,18 @@
 
 #include "raylib.h"
 #include "Element.h"
+#include "RandomGenerator.h"
+#include <array>
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
 
 class ElementRules
 {
 public:
-	ElementRules();
+	ElementRules(RandomGenerator* random);
 	Color GetCellColor(Element::Elements element);
+	Color GetCellColor(Element::Elements element, uint64_t noise);
 	
 	enum Rules
 	{
@@ -22,16 +26,52 @@ public:
 	};
 
 	std::unordered_map<Element::Elements, std::vector<Rules>> getRuleSet;
-	std::unordered_map<Rules, Vector2> ruleValues;
+
+	//Rule sets are known at compile time so SandStorm can bake them into its per element update kernels
+	static constexpr std::array sandRules =  { DOWN, SIDE_DOWN };
+	static constexpr std::array waterRules = { DOWN, SIDE, SIDE_DOWN };
+	static constexpr std::array smokeRules = { UP, SIDE_UP, SIDE };
+	static constexpr std::array lavaRules =  { DOWN, SIDE, SIDE_DOWN };
+	static constexpr std::array fireRules =  { UP, SIDE_UP, SIDE };
+
+	static constexpr std::array woodRules =  { STAY };
+	static constexpr std::array stationaryFireRules = { STAY };
+	static constexpr std::array<Rules, 0> noRules = {};
+
+	//Vertical offset of a rule, SIDE rules pick their horizontal offset (-1 or 1) at random
+	static constexpr int GetOffsetY(Rules rule) { return rule == UP || rule == SIDE_UP ? -1 : (rule == DOWN || rule == SIDE_DOWN ? 1 : 0); }
+	static constexpr bool IsSideRule(Rules rule) { return rule == SIDE || rule == SIDE_UP || rule == SIDE_DOWN; }
+
+	//Returns true for cell types an element interacts with when they are at one of its rule positions (has to match SandStorm::Interact)
+	static constexpr bool Reacts(Element::Elements element, unsigned char type)
+	{
+		switch (element)
+		{
+			case Element::Elements::SAND:  return type == Element::Elements::WATER || type == Element::Elements::SMOKE || type == Element::Elements::FIRE || type == Element::Elements::LAVA;
+			case Element::Elements::WATER: return type == Element::Elements::LAVA;
+			case Element::Elements::LAVA:  return type == Element::Elements::SAND || type == Element::Elements::WOOD;
+			case Element::Elements::FIRE:  return type == Element::Elements::WOOD;
+			default:                       return false;
+		}
+	}
+
+	template<Element::Elements E>
+	static constexpr const auto& GetRules()
+	{
+		if constexpr (E == Element::Elements::SAND) return sandRules;
+		else if constexpr (E == Element::Elements::WATER) return waterRules;
+		else if constexpr (E == Element::Elements::SMOKE) return smokeRules;
+		else if constexpr (E == Element::Elements::LAVA) return lavaRules;
+		else if constexpr (E == Element::Elements::FIRE) return fireRules;
+		else if constexpr (E == Element::Elements::WOOD) return woodRules;
+		else if constexpr (E == Element::Elements::STATIONARY_FIRE) return stationaryFireRules;
+		else return noRules;
+	}
+
+	float alphaRandomness = 200;
 
 private:
-	std::unordered_map<Element::Elements, Color> cellColorValues;
+	RandomGenerator* random = nullptr;
 
-	std::vector<Rules> sandRules;
-	std::vector<Rules> waterRules;
-	std::vector<Rules> smokeRules;
-	std::vector<Rules> lavaRules;
-	std::vector<Rules> woodRules;
-	std::vector<Rules> stationaryFireRules;
-	std::vector<Rules> fireRules;
+	std::unordered_map<Element::Elements, Color> cellColorValues;
 };
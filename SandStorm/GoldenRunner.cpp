@@ -0,0 +1,183 @@
+#include "GoldenRunner.h"
+#include "MargolusEngine.h"
+
+#include <fstream>
+
+GoldenRunner::GoldenRunner(SandStorm* sandStorm)
+{
+    this->sandStorm = sandStorm;
+
+    goldenDirectory = "Resources/Golden"; //golden traces are part of the source tree, loaded like the other resources
+
+    int parallelThreads = std::max(2u, std::thread::hardware_concurrency());
+
+    //every scan order/engine gets its own golden traces, parallel runs have to match their single threaded run
+    configs = {
+        { "column",             SandStorm::UpdateEngine::CELLULAR,  SandStorm::ScanOrder::COLUMN_MAJOR                  },
+        { "rows",               SandStorm::UpdateEngine::CELLULAR,  SandStorm::ScanOrder::ROW_BOTTOM_UP                 },
+        { "rowsalternate",      SandStorm::UpdateEngine::CELLULAR,  SandStorm::ScanOrder::ROW_BOTTOM_UP_ALTERNATE_ROW   },
+        { "tickalternate",      SandStorm::UpdateEngine::CELLULAR,  SandStorm::ScanOrder::ROW_BOTTOM_UP_ALTERNATE_TICK  },
+        { "bitplanes",          SandStorm::UpdateEngine::CELLULAR,  SandStorm::ScanOrder::ROW_BOTTOM_UP_ALTERNATE_ROW,  true    },
+        { "margolus",           SandStorm::UpdateEngine::MARGOLUS,  SandStorm::ScanOrder::ROW_BOTTOM_UP, false, 1                                   },
+        { "margolusparallel",   SandStorm::UpdateEngine::MARGOLUS,  SandStorm::ScanOrder::ROW_BOTTOM_UP, false, parallelThreads, "margolus"        },
+        { "activelists",        SandStorm::UpdateEngine::CELLULAR,  SandStorm::ScanOrder::ROW_BOTTOM_UP_ALTERNATE_ROW,  false,  1, "", true },
+        { "activebitplanes",    SandStorm::UpdateEngine::CELLULAR,  SandStorm::ScanOrder::ROW_BOTTOM_UP_ALTERNATE_ROW,  true,   1, "", true },
+    };
+}
+
+//Run all stock scenes with a fixed seed and compare their hash traces against the stored golden traces
+bool GoldenRunner::Run()
+{
+    if (record && !std::filesystem::exists(goldenDirectory)) //create 'Golden' folder if it doesn't exist
+        std::filesystem::create_directories(goldenDirectory);
+
+    if (sandStorm->imageImporter->GetImageCount() == 0) //running from the wrong directory would otherwise pass without checking anything
+    {
+        std::cout << "[golden] no scenes found in Textures/Images\n";
+        std::cout << "[golden] FAILED\n";
+        return false;
+    }
+
+    bool passed = true;
+    std::map<std::string, std::vector<uint64_t>> traces;
+
+    for (const auto& config : configs)
+    {
+        for (int scene = 0; scene < sandStorm->imageImporter->GetImageCount(); scene++)
+        {
+            std::string traceName = sandStorm->imageImporter->GetImageName(scene) + "_" + config.name;
+
+            std::vector<uint64_t> trace;
+            double msPerTick = 0;
+            if (!RunScene(scene, config, trace, msPerTick))
+            {
+                std::cout << "[golden] " << traceName << ": incremental hash diverged from full grid hash\n";
+                passed = false;
+                continue;
+            }
+
+            if (config.matchConfig.empty())
+            {
+                passed &= CompareTrace(traceName, trace);
+            }
+            else if (trace != traces[sandStorm->imageImporter->GetImageName(scene) + "_" + config.matchConfig])
+            {
+                std::cout << "[golden] " << traceName << ": differs from " << config.matchConfig << "\n";
+                passed = false;
+            }
+            else
+            {
+                std::cout << "[golden] " << traceName << ": matches " << config.matchConfig << "\n";
+            }
+
+            traces[traceName] = trace;
+            std::cout << "[golden] " << traceName << ": " << msPerTick << " ms/tick\n";
+        }
+    }
+
+    //every checked in golden trace has to belong to a scene and config that was run
+    if (!record && std::filesystem::exists(goldenDirectory))
+    {
+        for (const auto& traceFile : std::filesystem::directory_iterator(goldenDirectory))
+        {
+            std::string traceName = traceFile.path().stem().string();
+            if (traceFile.path().extension() == ".txt" && traces.find(traceName) == traces.end())
+            {
+                std::cout << "[golden] " << traceName << ": golden trace has no matching scene\n";
+                passed = false;
+            }
+        }
+    }
+
+    std::cout << "[golden] " << (passed ? "PASSED" : "FAILED") << "\n";
+    return passed;
+}
+
+//Import and simulate a single scene, returns false if the incremental hash doesn't match a full recalculation
+bool GoldenRunner::RunScene(int sceneIndex, const RunConfig& config, std::vector<uint64_t>& trace, double& msPerTick)
+{
+    sandStorm->updateEngine = config.updateEngine;
+    sandStorm->scanOrder = config.scanOrder;
+    sandStorm->useBitplanes = config.useBitplanes;
+    sandStorm->useActiveLists = config.useActiveLists;
+    sandStorm->updateScheduler->adaptive = false; //tick time based degrading isn't deterministic
+    sandStorm->margolusEngine->threadCount = config.threadCount;
+    sandStorm->SetSeed(seed);
+    sandStorm->imageImporter->ImportImage(sceneIndex);
+
+    trace.push_back(sandStorm->stateHasher->currentHash); //initial state is part of the trace as well
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticksPerScene; tick++)
+    {
+        sandStorm->Step();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+    msPerTick = elapsed.count() / ticksPerScene;
+    trace.insert(trace.end(), sandStorm->stateHasher->checkpoints.begin(), sandStorm->stateHasher->checkpoints.end());
+
+    return sandStorm->stateHasher->currentHash == sandStorm->ComputeStateHash();
+}
+
+//Compare a trace with its golden trace, a missing golden trace is a failure unless traces are being recorded
+bool GoldenRunner::CompareTrace(const std::string& traceName, const std::vector<uint64_t>& trace)
+{
+    std::filesystem::path tracePath = goldenDirectory / (traceName + ".txt");
+
+    if (record)
+    {
+        SaveTrace(tracePath, trace);
+        std::cout << "[golden] " << traceName << ": recorded golden trace\n";
+        return true;
+    }
+
+    std::vector<uint64_t> goldenTrace;
+    if (!LoadTrace(tracePath, goldenTrace))
+    {
+        std::cout << "[golden] " << traceName << ": missing golden trace " << tracePath.string() << " (record with --golden --record)\n";
+        return false;
+    }
+
+    if (trace.size() != goldenTrace.size())
+    {
+        std::cout << "[golden] " << traceName << ": trace length differs from golden trace\n";
+        return false;
+    }
+
+    for (size_t i = 0; i < trace.size(); i++)
+    {
+        if (trace[i] != goldenTrace[i])
+        {
+            std::cout << "[golden] " << traceName << ": mismatch at checkpoint " << i << "\n";
+            return false;
+        }
+    }
+
+    std::cout << "[golden] " << traceName << ": ok\n";
+    return true;
+}
+
+//Reads a trace file (one hexadecimal hash per line)
+bool GoldenRunner::LoadTrace(const std::filesystem::path& tracePath, std::vector<uint64_t>& trace)
+{
+    std::ifstream file(tracePath);
+    if (!file.is_open())
+        return false;
+
+    uint64_t hash = 0;
+    while (file >> std::hex >> hash)
+    {
+        trace.push_back(hash);
+    }
+    return true;
+}
+
+//Writes a trace file (one hexadecimal hash per line)
+void GoldenRunner::SaveTrace(const std::filesystem::path& tracePath, const std::vector<uint64_t>& trace)
+{
+    std::ofstream file(tracePath);
+    for (uint64_t hash : trace)
+    {
+        file << std::hex << hash << "\n";
+    }
+}
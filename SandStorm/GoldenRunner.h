@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SandStorm.h"
+
+class GoldenRunner
+{
+public:
+	GoldenRunner(SandStorm* sandStorm);
+	bool Run();
+
+	typedef struct RunConfig {
+		std::string name;
+		SandStorm::UpdateEngine updateEngine;
+		SandStorm::ScanOrder scanOrder;
+		bool useBitplanes = false;
+		int threadCount = 1;
+		std::string matchConfig = ""; //when set, traces have to be identical to the traces of this config instead of golden traces
+		bool useActiveLists = false;
+	};
+	std::vector<RunConfig> configs;
+
+	unsigned int seed = 1337;
+	int ticksPerScene = 600;
+	bool record = false; //overwrite the golden traces with the current traces instead of comparing them
+
+private:
+	bool RunScene(int sceneIndex, const RunConfig& config, std::vector<uint64_t>& trace, double& msPerTick);
+	bool CompareTrace(const std::string& traceName, const std::vector<uint64_t>& trace);
+
+	bool LoadTrace(const std::filesystem::path& tracePath, std::vector<uint64_t>& trace);
+	void SaveTrace(const std::filesystem::path& tracePath, const std::vector<uint64_t>& trace);
+
+	SandStorm* sandStorm = nullptr;
+	std::filesystem::path goldenDirectory;
+};
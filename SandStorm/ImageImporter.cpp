@@ -1,8 +1,10 @@
 #include "ImageImporter.h"
 #include "SandStorm.h"
+#include "EditHistory.h"
 
-ImageImporter::ImageImporter(int screenWidth)
+ImageImporter::ImageImporter(SandStorm* sandStorm, int screenWidth)
 {
+    this->sandStorm = sandStorm;
     this->screenWidth = screenWidth;
 
     std::filesystem::path directoryPath = GetApplicationDirectory(); //define Images path
@@ -32,7 +34,8 @@ ImageImporter::~ImageImporter()
 //Clear sim grid and import/place image pixels
 void ImageImporter::ImportImage(int imageIndex)
 {
-    SandStorm::instance->ResetSim();
+    sandStorm->editHistory->BeginGridEdit(); //reset and import are undone as a single edit
+    sandStorm->ResetSim();
     currentImportedImage = imageNames[imageIndex].c_str();
 
     Image image = LoadImage(imageNames[imageIndex].c_str());
@@ -47,13 +50,15 @@ void ImageImporter::ImportImage(int imageIndex)
             if (imagePixels[index].a > 0) {
                 
                 Element::Elements cellElement = GetCellElement(imagePixels[index]);
-                SandStorm::instance->SetCell(x + screenWidth * y, cellElement);
+                sandStorm->SetCell(static_cast<int>(x) + screenWidth * y, cellElement);
             }
         }
     }
 
     UnloadImageColors(imagePixels);
     UnloadImage(image);
+
+    sandStorm->editHistory->EndGridEdit();
 }
 
 //Returns correct cell element based on raw pixel color
@@ -80,6 +85,18 @@ bool ImageImporter::CompareColor(Color colorA, Color colorB)
     return r && g && b && a;
 }
 
+//Returns the amount of importable images
+int ImageImporter::GetImageCount()
+{
+    return maxImagesCount;
+}
+
+//Returns the file name (without extension) of an importable image
+std::string ImageImporter::GetImageName(int imageIndex)
+{
+    return std::filesystem::path(imageNames[imageIndex]).stem().string();
+}
+
 //Shortcuts for easily importing images
 void ImageImporter::OnUpdate()
 {
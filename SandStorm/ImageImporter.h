@@ -5,21 +5,28 @@
 #include <string>
 #include "Element.h"
 
+class SandStorm;
+
 class ImageImporter
 {
 public:
-    ImageImporter(int screenWidth);
+    ImageImporter(SandStorm* sandStorm, int screenWidth);
     ~ImageImporter();
 
     void ImportImage(int imageIndex);
     void OnUpdate();
 
+    int GetImageCount();
+    std::string GetImageName(int imageIndex);
+
     std::string currentImportedImage;
 
 private:
     Element::Elements GetCellElement(Color rawPixelColor);
     bool CompareColor(Color colorA, Color colorB);\
 
+    SandStorm* sandStorm = nullptr;
+
     int screenWidth = 0;
     int currentImage = 0;
     int maxImagesCount = 0;
@@ -1,69 +1,89 @@
 #include "InputHandler.h"
 #include "SandStorm.h"
+#include "EditHistory.h"
 
-InputHandler::InputHandler(Vector2 screenCenter)
+InputHandler::InputHandler(SandStorm* sandStorm, Vector2 screenCenter)
 {
+    this->sandStorm = sandStorm;
     this->screenCenter = screenCenter;
 }
 
 void InputHandler::OnUpdate(Vector2 mousePosition)
 {
-    SandStorm::instance->imageImporter->OnUpdate();
+    sandStorm->imageImporter->OnUpdate();
+
+    if (IsMouseButtonPressed(0) || IsMouseButtonPressed(1)) //start recording a brush stroke for undo
+        sandStorm->editHistory->BeginEdit();
 
     if (IsMouseButtonDown(0)) //placing cells
-        SandStorm::instance->ManipulateCell(true, mousePosition.x, mousePosition.y, SandStorm::instance->currentElement);
+        sandStorm->ManipulateCell(true, mousePosition.x, mousePosition.y, sandStorm->currentElement, 0, true);
 
     if (IsMouseButtonDown(1)) //removing cells
-        SandStorm::instance->ManipulateCell(false, mousePosition.x, mousePosition.y, SandStorm::instance->currentElement);
+        sandStorm->ManipulateCell(false, mousePosition.x, mousePosition.y, sandStorm->currentElement, 0, true);
 
     if (IsKeyPressed(KEY_LEFT_BRACKET)) //increase brush size
     {
-        SandStorm::instance->brushSize -= IsKeyDown(KEY_LEFT_CONTROL) ? SandStorm::instance->brushSizeScaler : 1;
-        SandStorm::instance->brushSize = std::max(SandStorm::instance->brushSize, 1);
+        sandStorm->brushSize -= IsKeyDown(KEY_LEFT_CONTROL) ? sandStorm->brushSizeScaler : 1;
+        sandStorm->brushSize = std::max(sandStorm->brushSize, 1);
     }
 
     if (IsKeyPressed(KEY_RIGHT_BRACKET)) //decrease brush size
-        SandStorm::instance->brushSize += IsKeyDown(KEY_LEFT_CONTROL) ? SandStorm::instance->brushSizeScaler : 1;
+        sandStorm->brushSize += IsKeyDown(KEY_LEFT_CONTROL) ? sandStorm->brushSizeScaler : 1;
 
     if (IsKeyDown(KEY_LEFT_CONTROL) && IsKeyPressed(KEY_S)) //make screenshot
-        SandStorm::instance->ExportScreenShot();
+        sandStorm->ExportScreenShot();
 
     if (IsKeyDown(KEY_LEFT_CONTROL) && IsMouseButtonPressed(0)) //create auto placer
     {
-        PlaySound(SandStorm::instance->placeAutoSFX);
-        SandStorm::instance->autoManipulators.push_back(SandStorm::AutoCellManipulator(mousePosition, SandStorm::instance->brushSize, true, SandStorm::instance->currentElement));
+        PlaySound(sandStorm->placeAutoSFX);
+        sandStorm->autoManipulators.push_back(SandStorm::AutoCellManipulator(mousePosition, sandStorm->brushSize, true, sandStorm->currentElement));
     }
 
     if (IsKeyDown(KEY_LEFT_CONTROL) && IsMouseButtonPressed(1)) //create auto destroyer
     {
-        PlaySound(SandStorm::instance->placeAutoSFX);
-        SandStorm::instance->autoManipulators.push_back(SandStorm::AutoCellManipulator(mousePosition, SandStorm::instance->brushSize, false));
+        PlaySound(sandStorm->placeAutoSFX);
+        sandStorm->autoManipulators.push_back(SandStorm::AutoCellManipulator(mousePosition, sandStorm->brushSize, false));
     }
 
-    if (IsKeyDown(KEY_LEFT_CONTROL) && IsKeyPressed(KEY_Z)) //undo last auto cell manipulator
+    if (IsMouseButtonReleased(0) || IsMouseButtonReleased(1)) //finish brush stroke
+        sandStorm->editHistory->EndEdit();
+
+    if (IsKeyDown(KEY_LEFT_CONTROL) && IsKeyPressed(KEY_Z)) //undo last edit (brush stroke, auto cell manipulator, reset or image import)
     {
-        if (SandStorm::instance->autoManipulators.size() == 0)
-            return;
+        if (sandStorm->editHistory->Undo())
+            PlaySound(sandStorm->removeAutoSFX);
+    }
 
-        PlaySound(SandStorm::instance->removeAutoSFX);
-        SandStorm::instance->autoManipulators.pop_back();
+    if (IsKeyDown(KEY_LEFT_CONTROL) && IsKeyPressed(KEY_Y)) //redo last undone edit
+    {
+        if (sandStorm->editHistory->Redo())
+            PlaySound(sandStorm->placeAutoSFX);
     }
 
     if (IsKeyPressed(KEY_TAB)) //reset sim
-        SandStorm::instance->ResetSim();
+        sandStorm->ResetSim();
 
     if (IsKeyPressed(KEY_GRAVE)) //toggle ui/debug info
-        SandStorm::instance->showHudInfo = !SandStorm::instance->showHudInfo;
+        sandStorm->showHudInfo = !sandStorm->showHudInfo;
 
     if (IsKeyPressed(KEY_SPACE)) //toggle updating
     {
-        SandStorm::instance->shouldUpdate = !SandStorm::instance->shouldUpdate;
-        SandStorm::instance->skipTimerActive = !SandStorm::instance->shouldUpdate;
+        sandStorm->shouldUpdate = !sandStorm->shouldUpdate;
+        sandStorm->skipTimerActive = !sandStorm->shouldUpdate;
     }
 
+    if (IsKeyPressed(KEY_O)) //cycle through scan orders
+        sandStorm->scanOrder = static_cast<SandStorm::ScanOrder>((sandStorm->scanOrder + 1) % 4);
+
+    if (IsKeyPressed(KEY_B)) //toggle bitplane sand updates
+        sandStorm->useBitplanes = !sandStorm->useBitplanes;
+
+    if (IsKeyPressed(KEY_L)) //toggle active cell lists
+        sandStorm->useActiveLists = !sandStorm->useActiveLists;
+
     if (IsKeyPressed(KEY_RIGHT)) //go couple frames forward
     {
-        SandStorm::instance->shouldUpdate = true;
-        SandStorm::instance->skipTimerActive = true;
+        sandStorm->shouldUpdate = true;
+        sandStorm->skipTimerActive = true;
     }
 }
\ No newline at end of file
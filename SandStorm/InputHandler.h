@@ -1,14 +1,16 @@
 #pragma once
 #include "raylib.h"
 
+class SandStorm;
+
 class InputHandler
 {
 public:
-	InputHandler(Vector2 screenCenter);
+	InputHandler(SandStorm* sandStorm, Vector2 screenCenter);
 	void OnUpdate(Vector2 mousePosition);
 
 private:
-	void OnResetSim();
+	SandStorm* sandStorm = nullptr;
 	Vector2 screenCenter = Vector2(0, 0);
 };
 
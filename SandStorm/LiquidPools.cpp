@@ -0,0 +1,193 @@
+#include "LiquidPools.h"
+#include "ActiveCells.h"
+
+#include <algorithm>
+
+LiquidPools::LiquidPools(SandStorm::CellInfo* map, ActiveCells* activeCells, int width, int height)
+{
+    this->map = map;
+    this->activeCells = activeCells;
+    this->width = width;
+    this->height = height;
+
+    poolIds.resize(width * height);
+    visitId.resize(width * height);
+}
+
+//Look for settled liquid bodies that contain one of the given cells (liquid cells that were updated this tick)
+void LiquidPools::DetectPools(const std::vector<int>& candidates)
+{
+    passStart = floodId;
+    for (int index : candidates)
+    {
+        unsigned char type = map[index].type;
+        if (!IsLiquid(type) || poolIds[index] != 0 || visitId[index] > passStart) //already checked in this pass
+            continue;
+
+        TryCreatePool(index, type);
+    }
+}
+
+//Flood fill the body a cell belongs to and collapse it into a pool if it has levelled out:
+//nothing in it can fall or react anymore and only cells in its top row can still move sideways.
+//Stops as soon as the body turns out to be unsettled, cells visited up to then mark the body as unsettled for the rest of the pass
+void LiquidPools::TryCreatePool(int start, unsigned char element)
+{
+    const auto& rules = element == Element::Elements::WATER ? ElementRules::waterRules : ElementRules::lavaRules;
+
+    floodId++;
+    body.clear();
+    body.push_back(start);
+    visitId[start] = floodId;
+
+    int top = height;
+    int sideRow = -1; //row of the cells that can still move sideways, there can only be one
+
+    for (size_t next = 0; next < body.size(); next++) //breadth first, surface cells close to the start are checked first
+    {
+        int index = body[next];
+
+        int x = index % width;
+        int y = index / width;
+        top = std::min(top, y);
+
+        //check every position the liquid's rules could move it to (both sides for SIDE rules)
+        for (ElementRules::Rules rule : rules)
+        {
+            int yPos = ElementRules::GetOffsetY(rule);
+            for (int xPos : { -1, 0, 1 })
+            {
+                bool outOfBounds = x + xPos < 0 || x + xPos >= width || y + yPos < 0 || y + yPos >= height;
+                if ((xPos != 0) != ElementRules::IsSideRule(rule) || outOfBounds)
+                    continue;
+
+                unsigned char type = map[(x + xPos) + width * (y + yPos)].type;
+                if (ElementRules::Reacts(static_cast<Element::Elements>(element), type))
+                    return;
+
+                if (type == Element::Elements::UNOCCUPIED)
+                {
+                    if (yPos != 0 || (sideRow >= 0 && sideRow != y)) //can still fall or the surface isn't level
+                        return;
+                    sideRow = y;
+                }
+            }
+        }
+
+        //continue with connected cells of the same liquid
+        int neighbours[4] = { index - width, index + width, index - 1, index + 1 };
+        bool inside[4] = { y > 0, y < height - 1, x > 0, x < width - 1 };
+        for (int i = 0; i < 4; i++)
+        {
+            int neighbour = neighbours[i];
+            if (!inside[i] || map[neighbour].type != element || visitId[neighbour] == floodId)
+                continue;
+
+            if (visitId[neighbour] > passStart) //connected to a body that was already found to be unsettled
+                return;
+
+            visitId[neighbour] = floodId;
+            body.push_back(neighbour);
+        }
+    }
+
+    if (sideRow >= 0 && sideRow != top)
+        return;
+
+    int poolId = 0;
+    if (!freeIds.empty())
+    {
+        poolId = freeIds.back();
+        freeIds.pop_back();
+    }
+    else
+    {
+        pools.push_back(LiquidPool());
+        poolId = static_cast<int>(pools.size());
+    }
+
+    LiquidPool& pool = pools[poolId - 1];
+    pool.element = element;
+    pool.fillLevel = top;
+    pool.cells = body;
+    pool.surface.clear();
+
+    for (int index : body)
+    {
+        poolIds[index] = poolId;
+        activeCells->Sleep(index); //surface cells would keep themselves awake otherwise
+        if (index / width == top) pool.surface.push_back(index);
+    }
+    pooledCells += static_cast<int>(body.size());
+}
+
+//Dissolve pools when a cell inside or directly around them changes (boundary disturbed or the pool drains)
+void LiquidPools::OnCellChanged(int index)
+{
+    if (pooledCells == 0)
+        return;
+
+    int x = index % width;
+    int y = index / width;
+
+    for (int neighbourY = std::max(y - 1, 0); neighbourY <= std::min(y + 1, height - 1); neighbourY++)
+    {
+        for (int neighbourX = std::max(x - 1, 0); neighbourX <= std::min(x + 1, width - 1); neighbourX++)
+        {
+            int poolId = poolIds[neighbourX + width * neighbourY];
+            if (poolId != 0) Dissolve(poolId);
+        }
+    }
+}
+
+//Turn a pool back into regular cells, its surface is woken so the liquid can level out again
+void LiquidPools::Dissolve(int poolId)
+{
+    LiquidPool& pool = pools[poolId - 1];
+    for (int index : pool.cells)
+    {
+        poolIds[index] = 0;
+    }
+    for (int index : pool.surface)
+    {
+        activeCells->KeepAwake(index);
+    }
+
+    pooledCells -= static_cast<int>(pool.cells.size());
+    pool.cells.clear();
+    pool.surface.clear();
+    freeIds.push_back(poolId);
+}
+
+//Remove all pools without waking them (used when the grid is cleared or every cell gets woken anyway)
+void LiquidPools::Reset()
+{
+    std::fill(poolIds.begin(), poolIds.end(), 0);
+    pools.clear();
+    freeIds.clear();
+    pooledCells = 0;
+}
+
+//Returns true if a cell is part of a settled pool
+bool LiquidPools::IsPooled(int index)
+{
+    return poolIds[index] != 0;
+}
+
+//Returns the amount of settled pools
+int LiquidPools::GetPoolCount()
+{
+    return static_cast<int>(pools.size() - freeIds.size());
+}
+
+//Returns the amount of cells inside settled pools
+int LiquidPools::GetPooledCellCount()
+{
+    return pooledCells;
+}
+
+//Returns true for elements that can settle into pools
+bool LiquidPools::IsLiquid(unsigned char type)
+{
+    return type == Element::Elements::WATER || type == Element::Elements::LAVA;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+
+#include "SandStorm.h"
+
+class ActiveCells;
+
+class LiquidPools
+{
+public:
+	LiquidPools(SandStorm::CellInfo* map, ActiveCells* activeCells, int width, int height);
+
+	void DetectPools(const std::vector<int>& candidates);
+	void OnCellChanged(int index);
+	void Reset();
+
+	bool IsPooled(int index);
+	int GetPoolCount();
+	int GetPooledCellCount();
+
+	typedef struct LiquidPool {
+		unsigned char element = 0;
+		int fillLevel = 0; //row of the pool's surface
+		std::vector<int> cells;
+		std::vector<int> surface; //surface cells that could still move sideways, woken when the pool dissolves
+	};
+	std::vector<LiquidPool> pools; //pool id - 1, dissolved pools have no cells
+
+	int detectInterval = 30; //ticks between searches for settled bodies
+
+private:
+	void TryCreatePool(int start, unsigned char element);
+	void Dissolve(int poolId);
+
+	static bool IsLiquid(unsigned char type);
+
+	SandStorm::CellInfo* map = nullptr;
+	ActiveCells* activeCells = nullptr;
+	int width = 0;
+	int height = 0;
+
+	std::vector<int> poolIds; //pool id per cell, 0 = not pooled
+	std::vector<int> visitId; //last flood fill that visited a cell
+	std::vector<int> freeIds;
+	int floodId = 0;
+	int passStart = 0; //flood fills after this one belong to the current detection pass
+	int pooledCells = 0;
+
+	std::vector<int> body; //scratch list for TryCreatePool
+};
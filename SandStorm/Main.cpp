@@ -1,10 +1,59 @@
 #include "SandStorm.h"
+#include "GoldenRunner.h"
+#include "BatchRunner.h"
+#include "MargolusEngine.h"
 
 constexpr auto SCREEN_WIDTH = 512;
 constexpr auto SCREEN_HEIGHT = 512;
 
-int main()
+int main(int argc, char* argv[])
 {
+    bool runGolden = false; //run golden regression harness instead of the interactive sim
+    bool recordGolden = false; //overwrite the golden traces instead of comparing against them
+    bool runBatch = false; //run many seeded headless worlds across all cores
+    bool useMargolus = false;
+    int threadCount = 0;
+    int worldCount = 64;
+    int tickCount = 0;
+    std::string shareName; //shared memory frame export for external tools, off by default
+    int shareInterval = 0; //0 = publish at the exporter's default cadence
+
+    for (int i = 1; i < argc; i++) //parse command line options
+    {
+        std::string argument = argv[i];
+        if (argument == "--golden") runGolden = true;
+        if (argument == "--record") recordGolden = true;
+        if (argument == "--batch") runBatch = true;
+        if (argument == "--engine=margolus") useMargolus = true;
+        if (argument.starts_with("--threads=")) threadCount = std::stoi(argument.substr(10));
+        if (argument.starts_with("--worlds=")) worldCount = std::stoi(argument.substr(9));
+        if (argument.starts_with("--ticks=")) tickCount = std::stoi(argument.substr(8));
+        if (argument == "--share") shareName = "SandStorm";
+        if (argument.starts_with("--share=")) shareName = argument.substr(8);
+        if (argument.starts_with("--share-interval=")) shareInterval = std::stoi(argument.substr(17));
+    }
+
+    if (runGolden) //headless runs don't need a window
+    {
+        SandStorm* sandStorm = new SandStorm(true);
+        GoldenRunner goldenRunner(sandStorm);
+        goldenRunner.record = recordGolden;
+        bool passed = goldenRunner.Run();
+
+        delete sandStorm;
+        return passed ? 0 : 1;
+    }
+
+    if (runBatch)
+    {
+        BatchRunner batchRunner(threadCount);
+        if (useMargolus) batchRunner.updateEngine = SandStorm::UpdateEngine::MARGOLUS;
+        if (tickCount > 0) batchRunner.ticksPerWorld = tickCount;
+
+        batchRunner.Run(worldCount);
+        return 0;
+    }
+
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "SandStorm Engine"); //create raylib window
 
     Image image = LoadImage("Textures/icon.png");
@@ -14,6 +63,10 @@ int main()
     DisableCursor();
 
     SandStorm* sandStorm = new SandStorm();
+    if (useMargolus) sandStorm->updateEngine = SandStorm::UpdateEngine::MARGOLUS;
+    if (threadCount > 0) sandStorm->margolusEngine->threadCount = threadCount;
+    if (!shareName.empty()) sandStorm->EnableSharedExport(shareName, shareInterval);
+
     while (!WindowShouldClose())
     {
         float deltaTime = GetFrameTime(); //calculate deltaTime
@@ -26,4 +79,4 @@ int main()
 
     CloseWindow();
     return 0;
-}
\ No newline at end of file
+}
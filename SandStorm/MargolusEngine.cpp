@@ -0,0 +1,373 @@
+#include "MargolusEngine.h"
+
+//Block slots:  0 1
+//              2 3
+MargolusEngine::MargolusEngine(ElementRules* elementRules)
+{
+    this->elementRules = elementRules;
+
+    //Build the transition table for every possible block state once, updating a block is a single lookup after this
+    transitions.resize(BLOCK_STATES * 2);
+    for (int blockState = 0; blockState < BLOCK_STATES; blockState++)
+    {
+        BuildTransition(blockState, 0);
+        BuildTransition(blockState, 1);
+    }
+}
+
+MargolusEngine::~MargolusEngine()
+{
+    StopWorkers();
+}
+
+//Simulate a single block using the element rules, same rule order and interactions as SandStorm::UpdateCell
+void MargolusEngine::BuildTransition(int blockState, int variant)
+{
+    unsigned char oldTypes[4];
+    unsigned char types[4];
+    unsigned char source[4];
+    bool isDone[4] = { false, false, false, false };
+
+    for (int slot = 0, state = blockState; slot < 4; slot++, state /= Element::ELEMENT_COUNT)
+    {
+        oldTypes[slot] = state % Element::ELEMENT_COUNT;
+        types[slot] = oldTypes[slot];
+        source[slot] = slot;
+    }
+
+    const int processOrder[4] = { 2, 3, 0, 1 }; //bottom row first, same as the bottom-up sweep
+    for (int slot : processOrder)
+    {
+        if (isDone[slot] || types[slot] == Element::Elements::UNOCCUPIED)
+            continue;
+
+        auto ruleSet = elementRules->getRuleSet.find(static_cast<Element::Elements>(types[slot]));
+        if (ruleSet == elementRules->getRuleSet.end()) //static cells (wall/obsidian) have no rules
+            continue;
+
+        for (const auto& rule : ruleSet->second)
+        {
+            int target = GetRuleTarget(slot, rule, variant == 1);
+            if (target < 0) //desired position is outside of this block
+                continue;
+
+            if (types[target] == Element::Elements::UNOCCUPIED) //move into empty cell
+            {
+                types[target] = types[slot];
+                source[target] = source[slot];
+                types[slot] = Element::Elements::UNOCCUPIED;
+                isDone[target] = true;
+                break;
+            }
+
+            unsigned char cell = types[slot];
+            unsigned char targetCell = types[target];
+            int interaction = ResolveInteraction(cell, targetCell, rule);
+            if (interaction == 0)
+                continue;
+
+            if (interaction == 1) //swap both cells
+            {
+                std::swap(types[slot], types[target]);
+                std::swap(source[slot], source[target]);
+            }
+            else //reaction, changed cells become new cells
+            {
+                if (cell != types[slot]) source[slot] = NEW_CELL;
+                if (targetCell != types[target]) source[target] = NEW_CELL;
+
+                types[slot] = cell;
+                types[target] = targetCell;
+            }
+
+            isDone[slot] = true;
+            isDone[target] = true;
+            break;
+        }
+    }
+
+    BlockTransition& transition = transitions[blockState * 2 + variant];
+    for (int slot = 0; slot < 4; slot++)
+    {
+        transition.type[slot] = types[slot];
+        transition.source[slot] = source[slot];
+
+        if (types[slot] != oldTypes[slot] || source[slot] != slot)
+            transition.changed = true;
+
+        if (types[slot] == Element::Elements::STATIONARY_FIRE || types[slot] == Element::Elements::FIRE)
+            transition.burning = true;
+    }
+}
+
+//Returns 0 when there is no interaction, 1 when both cells swap and 2 when the cells react into new cells
+int MargolusEngine::ResolveInteraction(unsigned char& cell, unsigned char& target, ElementRules::Rules rule)
+{
+    //swap sand with water, smoke or fire if sand falls on top of it
+    if (cell == Element::Elements::SAND && (target == Element::Elements::WATER || target == Element::Elements::SMOKE || target == Element::Elements::FIRE))
+        return 1;
+
+    //create smoke and obsidian when water or sand touches lava
+    if ((cell == Element::Elements::SAND || cell == Element::Elements::WATER) && target == Element::Elements::LAVA)
+    {
+        cell = Element::Elements::SMOKE;
+        target = Element::Elements::OBSIDIAN;
+        return 2;
+    }
+
+    //create obsidian when lava touches sand
+    if (cell == Element::Elements::LAVA && target == Element::Elements::SAND)
+    {
+        target = Element::Elements::OBSIDIAN;
+        return 2;
+    }
+
+    //create fire when lava touches wood
+    if (cell == Element::Elements::LAVA && target == Element::Elements::WOOD)
+    {
+        target = Element::Elements::STATIONARY_FIRE;
+        return 2;
+    }
+
+    //initial wood burning
+    if (cell == Element::Elements::FIRE && target == Element::Elements::WOOD && rule == ElementRules::Rules::UP)
+    {
+        cell = Element::Elements::UNOCCUPIED;
+        target = Element::Elements::STATIONARY_FIRE;
+        return 2;
+    }
+    return 0;
+}
+
+//Returns the slot a rule wants to move to, -1 if that position isn't inside the block
+int MargolusEngine::GetRuleTarget(int slot, ElementRules::Rules rule, bool sideRight)
+{
+    bool isTop = slot < 2;
+    bool isLeft = slot % 2 == 0;
+    bool towardsPartner = isLeft == sideRight; //random side points to the other column of this block
+
+    switch (rule)
+    {
+        case ElementRules::Rules::UP:           return isTop ? -1 : slot - 2;
+        case ElementRules::Rules::DOWN:         return isTop ? slot + 2 : -1;
+        case ElementRules::Rules::SIDE:         return towardsPartner ? slot ^ 1 : -1;
+        case ElementRules::Rules::SIDE_UP:      return !isTop && towardsPartner ? (slot - 2) ^ 1 : -1;
+        case ElementRules::Rules::SIDE_DOWN:    return isTop && towardsPartner ? (slot + 2) ^ 1 : -1;
+        default:                                return -1;
+    }
+}
+
+//Update all blocks for a single tick, returns the change of the grid hash
+uint64_t MargolusEngine::Step(SandStorm::CellInfo* map, Color* pixels, int width, int height, int tick, unsigned int seed, ChunkMap* chunkMap)
+{
+    this->map = map;
+    this->pixels = pixels;
+    this->chunkMap = chunkMap;
+    this->width = width;
+    this->height = height;
+
+    int offset = tick % 2; //alternate block grid offset every tick
+    int blockRows = (height - offset) / 2;
+    uint64_t tickSeed = StateHasher::TickSeed(seed, tick);
+
+    if (threadCount <= 1)
+        return UpdateBlockRows(0, blockRows, offset, tickSeed);
+
+    if (static_cast<int>(workers.size()) != threadCount - 1) //pool is only (re)started when the thread count changes
+        StartWorkers(threadCount - 1);
+
+    //blocks never overlap, so every thread gets its own band of block rows
+    int rowsPerThread = (blockRows + threadCount - 1) / threadCount;
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        stepOffset = offset;
+        stepBlockRows = blockRows;
+        stepRowsPerThread = rowsPerThread;
+        stepTickSeed = tickSeed;
+        pendingWorkers = static_cast<int>(workers.size());
+        generation++;
+    }
+    workReady.notify_all();
+
+    uint64_t hashDelta = UpdateBlockRows(0, std::min(rowsPerThread, blockRows), offset, tickSeed); //calling thread takes the first band
+
+    std::unique_lock<std::mutex> lock(workMutex);
+    workDone.wait(lock, [this]() { return pendingWorkers == 0; });
+    for (uint64_t workerDelta : hashDeltas)
+    {
+        hashDelta ^= workerDelta;
+    }
+    return hashDelta;
+}
+
+//Start a pool of workers, worker n updates band n + 1
+void MargolusEngine::StartWorkers(int workerCount)
+{
+    StopWorkers();
+
+    stopWorkers = false;
+    hashDeltas.assign(workerCount, 0);
+    for (int worker = 0; worker < workerCount; worker++)
+    {
+        workers.emplace_back(&MargolusEngine::WorkerLoop, this, worker, generation);
+    }
+}
+
+//Signal all workers to exit and wait for them
+void MargolusEngine::StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        stopWorkers = true;
+    }
+    workReady.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+}
+
+//Worker loop, sleeps until the next parallel tick and updates its band
+void MargolusEngine::WorkerLoop(int worker, uint64_t startGeneration)
+{
+    uint64_t seenGeneration = startGeneration;
+    std::unique_lock<std::mutex> lock(workMutex);
+
+    while (true)
+    {
+        workReady.wait(lock, [this, seenGeneration]() { return stopWorkers || generation != seenGeneration; });
+        if (stopWorkers)
+            return;
+        seenGeneration = generation;
+
+        int firstBlockRow = (worker + 1) * stepRowsPerThread;
+        int lastBlockRow = std::min(firstBlockRow + stepRowsPerThread, stepBlockRows);
+        int offset = stepOffset;
+        uint64_t tickSeed = stepTickSeed;
+
+        lock.unlock();
+        uint64_t hashDelta = firstBlockRow < lastBlockRow ? UpdateBlockRows(firstBlockRow, lastBlockRow, offset, tickSeed) : 0;
+        lock.lock();
+
+        hashDeltas[worker] = hashDelta;
+        if (--pendingWorkers == 0)
+            workDone.notify_one();
+    }
+}
+
+//Update a band of block rows
+uint64_t MargolusEngine::UpdateBlockRows(int firstBlockRow, int lastBlockRow, int offset, uint64_t tickSeed)
+{
+    uint64_t hashDelta = 0;
+    for (int blockRow = firstBlockRow; blockRow < lastBlockRow; blockRow++)
+    {
+        int y = offset + blockRow * 2;
+        for (int x = offset; x + 1 < width; x += 2)
+        {
+            int index = x + width * y;
+            hashDelta ^= UpdateBlock(index, StateHasher::Mix(tickSeed ^ static_cast<uint64_t>(index))); //random value only depends on seed, tick and position
+        }
+    }
+    return hashDelta;
+}
+
+//Apply the transition of a single block, returns the change of the grid hash
+uint64_t MargolusEngine::UpdateBlock(int index, uint64_t random)
+{
+    int indices[4] = { index, index + 1, index + width, index + width + 1 };
+
+    int blockState = map[indices[0]].type + Element::ELEMENT_COUNT * (map[indices[1]].type + Element::ELEMENT_COUNT * (map[indices[2]].type + Element::ELEMENT_COUNT * map[indices[3]].type));
+    if (blockState == 0) //skip empty blocks
+        return 0;
+
+    const BlockTransition& transition = transitions[blockState * 2 + (random & 1)];
+    uint64_t hashDelta = 0;
+
+    if (transition.changed)
+    {
+        SandStorm::CellInfo oldCells[4] = { map[indices[0]], map[indices[1]], map[indices[2]], map[indices[3]] };
+        Color oldPixels[4] = { pixels[indices[0]], pixels[indices[1]], pixels[indices[2]], pixels[indices[3]] };
+
+        for (int slot = 0; slot < 4; slot++)
+        {
+            int cellIndex = indices[slot];
+            unsigned char source = transition.source[slot];
+            Element::Elements element = static_cast<Element::Elements>(transition.type[slot]);
+
+            hashDelta ^= StateHasher::CellKey(cellIndex, oldCells[slot].type) ^ StateHasher::CellKey(cellIndex, element);
+            if (oldCells[slot].type != element) chunkMap->MarkDirty(cellIndex);
+
+            if (element == Element::Elements::UNOCCUPIED)
+            {
+                map[cellIndex] = SandStorm::CellInfo();
+                pixels[cellIndex] = BLACK;
+            }
+            else if (source == NEW_CELL)
+            {
+                InitCell(cellIndex, element, StateHasher::Mix(random + slot));
+            }
+            else //cell moved, bring its state and color along
+            {
+                map[cellIndex] = oldCells[source];
+                pixels[cellIndex] = oldPixels[source];
+            }
+        }
+    }
+
+    if (transition.burning)
+        hashDelta ^= UpdateBurning(indices, random);
+
+    return hashDelta;
+}
+
+//Fire life time and wood burning, these depend on cell state so they can't be part of the transition table
+uint64_t MargolusEngine::UpdateBurning(int* indices, uint64_t random)
+{
+    bool hasStationaryFire = false;
+    for (int slot = 0; slot < 4; slot++)
+    {
+        if (map[indices[slot]].type == Element::Elements::STATIONARY_FIRE)
+            hasStationaryFire = true;
+    }
+
+    uint64_t hashDelta = 0;
+    for (int slot = 0; slot < 4; slot++)
+    {
+        SandStorm::CellInfo& cell = map[indices[slot]];
+        uint64_t cellRandom = StateHasher::Mix(random ^ (slot + 1));
+
+        bool isFire = cell.type == Element::Elements::STATIONARY_FIRE || cell.type == Element::Elements::FIRE;
+        bool isBurningWood = cell.type == Element::Elements::WOOD && hasStationaryFire;
+        if (!isFire && !isBurningWood)
+            continue;
+
+        cell.updateTick++;
+        if (cell.updateTick < cell.lifeTime)
+            continue;
+
+        //fire despawning (80% chance to disappear, otherwise it turns into smoke) or wood catching fire
+        Element::Elements element = Element::Elements::STATIONARY_FIRE;
+        if (isFire) element = cellRandom % 101 > 80 ? Element::Elements::SMOKE : Element::Elements::UNOCCUPIED;
+
+        hashDelta ^= StateHasher::CellKey(indices[slot], cell.type) ^ StateHasher::CellKey(indices[slot], element);
+        chunkMap->MarkDirty(indices[slot]);
+        InitCell(indices[slot], element, cellRandom >> 8);
+    }
+    return hashDelta;
+}
+
+//Thread safe version of SandStorm::SetCell, all randomness comes from the given random value
+void MargolusEngine::InitCell(int index, Element::Elements element, uint64_t random)
+{
+    map[index] = SandStorm::CellInfo();
+    map[index].type = element;
+    pixels[index] = elementRules->GetCellColor(element, random);
+
+    //Initialize dynamic cells with a random life time value
+    uint64_t lifeRandom = random >> 16;
+    if (element == Element::Elements::STATIONARY_FIRE) map[index].lifeTime = static_cast<unsigned char>(75 + lifeRandom % 181); //75..255, life time is a single byte
+    if (element == Element::Elements::FIRE) map[index].lifeTime = static_cast<unsigned char>(25 + lifeRandom % 76);
+    if (element == Element::Elements::WOOD) map[index].lifeTime = static_cast<unsigned char>(10 + lifeRandom % 16);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SandStorm.h"
+#include "ChunkMap.h"
+
+class MargolusEngine
+{
+public:
+	MargolusEngine(ElementRules* elementRules);
+	~MargolusEngine();
+
+	uint64_t Step(SandStorm::CellInfo* map, Color* pixels, int width, int height, int tick, unsigned int seed, ChunkMap* chunkMap);
+
+	int threadCount = 1;
+
+private:
+	typedef struct BlockTransition {
+		unsigned char source[4];
+		unsigned char type[4];
+		bool changed = false;
+		bool burning = false;
+	};
+
+	void BuildTransition(int blockState, int variant);
+	int ResolveInteraction(unsigned char& cell, unsigned char& target, ElementRules::Rules rule);
+	int GetRuleTarget(int slot, ElementRules::Rules rule, bool sideRight);
+
+	uint64_t UpdateBlockRows(int firstBlockRow, int lastBlockRow, int offset, uint64_t tickSeed);
+	uint64_t UpdateBlock(int index, uint64_t random);
+	uint64_t UpdateBurning(int* indices, uint64_t random);
+
+	void InitCell(int index, Element::Elements element, uint64_t random);
+
+	void StartWorkers(int workerCount);
+	void StopWorkers();
+	void WorkerLoop(int worker, uint64_t startGeneration);
+
+	static constexpr unsigned char NEW_CELL = 255;
+	static constexpr int BLOCK_STATES = Element::ELEMENT_COUNT * Element::ELEMENT_COUNT * Element::ELEMENT_COUNT * Element::ELEMENT_COUNT;
+
+	std::vector<BlockTransition> transitions; //two variants (random side left/right) per block state
+	ElementRules* elementRules = nullptr;
+
+	SandStorm::CellInfo* map = nullptr;
+	Color* pixels = nullptr;
+	ChunkMap* chunkMap = nullptr;
+	int width = 0;
+	int height = 0;
+
+	//persistent worker pool, every worker owns a fixed band of block rows and is woken once per tick
+	std::vector<std::thread> workers;
+	std::vector<uint64_t> hashDeltas;
+	std::mutex workMutex;
+	std::condition_variable workReady;
+	std::condition_variable workDone;
+	uint64_t generation = 0; //incremented for every parallel tick
+	int pendingWorkers = 0;
+	bool stopWorkers = false;
+
+	int stepOffset = 0;
+	int stepBlockRows = 0;
+	int stepRowsPerThread = 0;
+	uint64_t stepTickSeed = 0;
+};
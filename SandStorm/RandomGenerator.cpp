@@ -0,0 +1,25 @@
+#include "RandomGenerator.h"
+#include "StateHasher.h"
+
+#include <utility>
+
+RandomGenerator::RandomGenerator(unsigned int seed)
+{
+    SetSeed(seed);
+}
+
+//Restart the sequence from the given seed
+void RandomGenerator::SetSeed(unsigned int seed)
+{
+    state = StateHasher::Mix(seed);
+}
+
+//Returns a random value between min and max (both included), same contract as raylib's GetRandomValue
+int RandomGenerator::GetValue(int min, int max)
+{
+    if (min > max)
+        std::swap(min, max);
+
+    uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+    return static_cast<int>(min + StateHasher::Mix(state++) % range);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+
+class RandomGenerator
+{
+public:
+	RandomGenerator(unsigned int seed = 0);
+
+	void SetSeed(unsigned int seed);
+	int GetValue(int min, int max);
+
+private:
+	uint64_t state = 0;
+};
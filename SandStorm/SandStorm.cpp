@@ -1,34 +1,54 @@
 #include "SandStorm.h"
+#include "MargolusEngine.h"
+#include "BitplaneEngine.h"
+#include "ChunkMap.h"
+#include "EditHistory.h"
+#include "ActiveCells.h"
+#include "LiquidPools.h"
+#include "SharedFrameExport.h"
 
-SandStorm* SandStorm::instance = nullptr;
+#include <bit>
 
 constexpr auto WIDTH = 512;
 constexpr auto HEIGHT = 512;
 
 constexpr int size = WIDTH * HEIGHT;
+static_assert(WIDTH % 64 == 0, "bitplane rows need to be a multiple of 64 cells");
 
-Color pixels[size];
-SandStorm::CellInfo map[size];
-
-SandStorm::SandStorm() //constructor
+SandStorm::SandStorm(bool headless) //constructor
 {
-    instance = this;
-    cursor = LoadTexture("Textures/cursor.png");
+    this->headless = headless;
 
-    screenImage = GenImageColor(WIDTH, HEIGHT, UNOCCUPIED_CELL);
-    screenTexture = LoadTextureFromImage(screenImage);
+    map.resize(size);
+    pixels.assign(size, UNOCCUPIED_CELL); //set texture background to black
 
-    for (int i = 0; i < WIDTH * HEIGHT; i++) //set texture background to black
+    if (!headless)
     {
-        pixels[i] = UNOCCUPIED_CELL;
+        cursor = LoadTexture("Textures/cursor.png");
+
+        screenImage = GenImageColor(WIDTH, HEIGHT, UNOCCUPIED_CELL);
+        screenTexture = LoadTextureFromImage(screenImage);
+        UnloadImage(screenImage);
+        screenImage.data = pixels.data(); //update image with black background
     }
 
-    screenImage.data = pixels; //update image with black background
-    elementRules = new ElementRules(); //create cell rules ref
-    inputHandler = new InputHandler(Vector2(WIDTH / 2, HEIGHT / 2)); //create InputHandler ref
-    imageImporter = new ImageImporter(WIDTH); //create ImageImporter ref
+    elementRules = new ElementRules(&random); //create cell rules ref
+    inputHandler = new InputHandler(this, Vector2(WIDTH / 2, HEIGHT / 2)); //create InputHandler ref
+    imageImporter = new ImageImporter(this, WIDTH); //create ImageImporter ref
+    stateHasher = new StateHasher(); //create StateHasher ref
+    updateScheduler = new UpdateScheduler(); //create UpdateScheduler ref
+    margolusEngine = new MargolusEngine(elementRules); //create MargolusEngine ref
+    margolusEngine->threadCount = std::max(1u, std::thread::hardware_concurrency());
+    bitplaneEngine = new BitplaneEngine(this, WIDTH, HEIGHT); //create BitplaneEngine ref
+    chunkMap = new ChunkMap(map.data(), WIDTH, HEIGHT); //create ChunkMap ref
+    editHistory = new EditHistory(this, size); //create EditHistory ref
+    activeCells = new ActiveCells(map.data(), WIDTH, HEIGHT); //create ActiveCells ref
+    liquidPools = new LiquidPools(map.data(), activeCells, WIDTH, HEIGHT); //create LiquidPools ref
+
+    SetSeed(static_cast<unsigned int>(time(0))); //set randoms seed
+    if (headless)
+        return;
 
-    srand(time(0)); //set randoms seed
     InitAudioDevice();
 
     removeAutoSFX =  LoadSound("Resources/Audio/removeAuto.wav");
@@ -40,6 +60,16 @@ SandStorm::~SandStorm() //deconstructor
 {
     delete elementRules;
     delete inputHandler;
+    delete imageImporter;
+    delete stateHasher;
+    delete updateScheduler;
+    delete margolusEngine;
+    delete bitplaneEngine;
+    delete chunkMap;
+    delete editHistory;
+    delete activeCells;
+    delete liquidPools;
+    delete sharedFrameExport;
 }
 
 //Main update loop
@@ -52,6 +82,44 @@ void SandStorm::Update(float deltaTime)
 
     //Try update all active cells
     if (shouldUpdate)
+        Step();
+
+    UpdateTexture(screenTexture, pixels.data()); //NOTE: does texture need to be updated every frame?
+}
+
+//Advance the simulation by a single tick
+void SandStorm::Step()
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    if (updateEngine == UpdateEngine::MARGOLUS) //block based engine, doesn't use scan orders, update stamps or the scheduler
+    {
+        stateHasher->ApplyDelta(margolusEngine->Step(map.data(), pixels.data(), WIDTH, HEIGHT, stateHasher->tick, seed, chunkMap));
+        chunkMap->RefreshDirtyChunks();
+        bitplanesDirty = true; //grid changed without going through SetCell
+        activeCellsDirty = true;
+    }
+    else
+    {
+        StepCellular();
+    }
+    stateHasher->OnTick();
+
+    std::chrono::duration<double, std::milli> tickTime = std::chrono::steady_clock::now() - startTime;
+    if (updateEngine == UpdateEngine::CELLULAR) //paired with BeginTick in StepCellular, Margolus ticks don't use the scheduler
+        updateScheduler->EndTick(tickTime.count());
+
+    if (sharedFrameExport != nullptr && stateHasher->tick % sharedFrameExport->publishInterval == 0) //publishing is not part of the tick budget, exporting never degrades the sim
+        sharedFrameExport->Publish(pixels.data(), &map[0].type, sizeof(CellInfo), stateHasher->tick, stateHasher->currentHash);
+}
+
+//Single tick of the cell by cell engine
+void SandStorm::StepCellular()
+{
+    updateScheduler->BeginTick(stateHasher->tick);
+    updateStamp = updateStamp == 255 ? 1 : updateStamp + 1; //new stamp for this tick, 0 is reserved for 'not updated'
+
+    if (scanOrder == ScanOrder::COLUMN_MAJOR) //legacy sweep, jumps a full row for every cell
     {
         for (int x = 0; x < WIDTH; x++)
         {
@@ -60,8 +128,97 @@ void SandStorm::Update(float deltaTime)
                 UpdateCell(x, y);
             }
         }
+        activeCellsDirty = true; //sweeps don't keep track of sleeping cells
+    }
+    else //row major sweeps from the bottom up, falling cells are never revisited
+    {
+        if (useBitplanes && bitplanesDirty)
+        {
+            bitplaneEngine->Rebuild(map.data());
+            bitplanesDirty = false;
+        }
+
+        if (useActiveLists) //only awake cells get queued, they are updated per element after the sweep
+        {
+            if (activeCellsDirty)
+            {
+                activeCells->WakeAll();
+                liquidPools->Reset(); //pools can be stale after sweeps or Margolus ticks, they get detected again
+                activeCellsDirty = false;
+            }
+            activeCells->BeginTick(!useBitplanes);
+        }
+        else
+        {
+            activeCellsDirty = true;
+        }
+
+        uint64_t tickSeed = StateHasher::TickSeed(seed, stateHasher->tick);
+        uint64_t genericMask[WIDTH / 64];
+
+        for (int y = HEIGHT - 2; y >= 0; y--)
+        {
+            bool leftToRight = true;
+            if (scanOrder == ScanOrder::ROW_BOTTOM_UP_ALTERNATE_ROW) leftToRight = (y + stateHasher->tick) % 2 == 0;
+            if (scanOrder == ScanOrder::ROW_BOTTOM_UP_ALTERNATE_TICK) leftToRight = stateHasher->tick % 2 == 0;
+
+            if (useBitplanes) //resolve plain sand 64 cells at a time, only visit the remaining cells one by one
+            {
+                bitplaneEngine->UpdateSandRow(y, tickSeed, updateScheduler->isActive[Element::Elements::SAND], genericMask);
+
+                if (useActiveLists) activeCells->QueueRow(y, genericMask, leftToRight);
+                else UpdateMaskedRow(y, genericMask, leftToRight);
+            }
+            else if (useActiveLists)
+            {
+                activeCells->QueueRow(y, nullptr, leftToRight);
+            }
+            else if (leftToRight)
+            {
+                for (int x = 0; x < WIDTH; x++)
+                    UpdateCell(x, y);
+            }
+            else
+            {
+                for (int x = WIDTH - 1; x >= 0; x--)
+                    UpdateCell(x, y);
+            }
+        }
+
+        if (useActiveLists)
+        {
+            UpdateActiveCells();
+            activeCells->EndTick();
+
+            if (stateHasher->tick % liquidPools->detectInterval == 0) //collapse liquid bodies that levelled out, their surface stops moving
+            {
+                liquidPools->DetectPools(activeCells->buckets[Element::Elements::WATER]);
+                liquidPools->DetectPools(activeCells->buckets[Element::Elements::LAVA]);
+            }
+        }
+    }
+}
+
+//Update all cells of a row that are set in the given bit mask
+void SandStorm::UpdateMaskedRow(int y, const uint64_t* mask, bool leftToRight)
+{
+    constexpr int wordsPerRow = WIDTH / 64;
+    if (leftToRight)
+    {
+        for (int w = 0; w < wordsPerRow; w++)
+        {
+            for (uint64_t bits = mask[w]; bits != 0; bits &= bits - 1)
+                UpdateCell(w * 64 + std::countr_zero(bits), y);
+        }
+    }
+    else
+    {
+        for (int w = wordsPerRow - 1; w >= 0; w--)
+        {
+            for (uint64_t bits = mask[w]; bits != 0; bits &= ~(1ull << (63 - std::countl_zero(bits))))
+                UpdateCell(w * 64 + 63 - std::countl_zero(bits), y);
+        }
     }
-    UpdateTexture(screenTexture, pixels); //NOTE: does texture need to be updated every frame?
 }
 
 //Main render loop
@@ -84,6 +241,12 @@ void SandStorm::Render()
         DrawFPS(0, 0); //draw fps
         DrawText(GetElementString().c_str(), 0, 24, 24, GREEN); //draw current element and brush size
         DrawText(shouldUpdate ? "Active" : "Paused", 256 - 45, 0, 24, GREEN); //draw update state label
+        DrawText(updateEngine == UpdateEngine::MARGOLUS ? "Margolus" : GetScanOrderString().c_str(), 0, 48, 16, GREEN); //draw current engine/scan order
+        if (updateEngine == UpdateEngine::CELLULAR) DrawText(updateScheduler->GetStatusString().c_str(), 0, 64, 16, GREEN); //draw how often the scheduler had to degrade
+        std::string cellCount = "Cells " + std::to_string(chunkMap->GetTotalCount(currentElement));
+        if (useActiveLists) cellCount += " (" + std::to_string(activeCells->buckets[currentElement].size()) + " active)";
+        DrawText(cellCount.c_str(), 0, 80, 16, GREEN); //draw amount of (active) cells of the current element
+        if (useActiveLists) DrawText(("Pools " + std::to_string(liquidPools->GetPoolCount()) + " (" + std::to_string(liquidPools->GetPooledCellCount()) + " cells)").c_str(), 0, 96, 16, GREEN); //draw settled liquid pools
         DrawText(imageImporter->currentImportedImage.c_str(), 0, HEIGHT - 16, 16, GREEN); //draw update state label
     }
 
@@ -94,8 +257,12 @@ void SandStorm::Render()
         float xPos = manipulator.position.x;
         float yPos = manipulator.position.y;
 
+        Vector2 center = Vector2(static_cast<int>(xPos), static_cast<int>(yPos)); //same footprint as ManipulateCell
+        int radius = static_cast<int>(manipulator.position.z);
+        bool isIdle = manipulator.mode ? chunkMap->CountElementInCircle(center, radius, Element::Elements::UNOCCUPIED) == 0 : chunkMap->IsCircleEmpty(center, radius); //nothing left to fill/remove
+
         if(showHudInfo) DrawRectangleLines(xPos - manipulator.position.z, yPos - manipulator.position.z, scale, scale, manipulator.mode ? GREEN : RED);
-        if(shouldUpdate) ManipulateCell(manipulator.mode, xPos, yPos, manipulator.placeElement, manipulator.position.z);
+        if(shouldUpdate && !isIdle) ManipulateCell(manipulator.mode, xPos, yPos, manipulator.placeElement, manipulator.position.z);
     }
 
     EndDrawing();
@@ -106,211 +273,333 @@ void SandStorm::Render()
 //Update cell based on its rules
 void SandStorm::UpdateCell(int x, int y)
 {
-    int oldIndex = x + WIDTH * y;
-    int currentCell = map[oldIndex].type;
+    int index = x + WIDTH * y;
+    int currentCell = map[index].type;
 
     if (currentCell == 0 || currentCell == 3) //skip air (empty)/wall cells
         return;
 
-    if (map[oldIndex].isUpdated) //skip cell if it has already beed updated this frame
-    {
-        map[oldIndex].isUpdated = false;
+    if (map[index].updateStamp == updateStamp) //skip cell if it has already beed updated this tick
+        return;
+
+    if (!updateScheduler->isActive[currentCell]) //skip elements that aren't scheduled this tick
         return;
-    }
 
-    Element::Elements currentElement = static_cast<Element::Elements>(currentCell);
-    auto& cellRuleSet = elementRules->getRuleSet[currentElement]; //get the right ruleset based on cell element type
+    map[index].updateStamp = 0; //clear old stamp so it can't collide once the stamp wraps around
 
-    for (const auto& rule : cellRuleSet) //loop through all rules of the ruleset
+    switch (currentCell) //run the kernel of the cell's element
     {
-        int xPos = 0;
-        int yPos = 0;
+        case Element::Elements::SAND:            UpdateKernel<Element::Elements::SAND>(index, x, y);            break;
+        case Element::Elements::WATER:           UpdateKernel<Element::Elements::WATER>(index, x, y);           break;
+        case Element::Elements::SMOKE:           UpdateKernel<Element::Elements::SMOKE>(index, x, y);           break;
+        case Element::Elements::LAVA:            UpdateKernel<Element::Elements::LAVA>(index, x, y);            break;
+        case Element::Elements::WOOD:            UpdateKernel<Element::Elements::WOOD>(index, x, y);            break;
+        case Element::Elements::STATIONARY_FIRE: UpdateKernel<Element::Elements::STATIONARY_FIRE>(index, x, y); break;
+        case Element::Elements::FIRE:            UpdateKernel<Element::Elements::FIRE>(index, x, y);            break;
+    }
+}
 
-        if (elementRules->ruleValues.contains(rule))
-        {
-            Vector2 checkVector = elementRules->ruleValues[rule];
-            xPos = checkVector.x;
-            yPos = checkVector.y;
-        }
-        else if (rule == ElementRules::Rules::SIDE)
-        {
-            xPos = GetRandomValue(0, 1) == 0 ? -1 : 1;
-        }
-        else if (rule == ElementRules::Rules::SIDE_DOWN)
-        {
-            xPos = GetRandomValue(0, 1) == 0 ? -1 : 1;
-            yPos = 1;
-        }
-        else if (rule == ElementRules::Rules::SIDE_UP)
-        {
-            xPos = GetRandomValue(0, 1) == 0 ? -1 : 1;
-            yPos = -1;
-        }
+//Update all queued cells, one element bucket at a time
+void SandStorm::UpdateActiveCells()
+{
+    UpdateBucket<Element::Elements::SAND>();
+    UpdateBucket<Element::Elements::WATER>();
+    UpdateBucket<Element::Elements::SMOKE>();
+    UpdateBucket<Element::Elements::LAVA>();
+    UpdateBucket<Element::Elements::WOOD>();
+    UpdateBucket<Element::Elements::STATIONARY_FIRE>();
+    UpdateBucket<Element::Elements::FIRE>();
+}
+
+#pragma region CellKernels
+//Run all queued cells of an element through its kernel, cells that can't do anything anymore fall asleep
+template<Element::Elements E>
+void SandStorm::UpdateBucket()
+{
+    std::vector<int>& bucket = activeCells->buckets[E];
+    if (!updateScheduler->isActive[E]) //not scheduled this tick, try again next tick
+    {
+        for (int index : bucket)
+            activeCells->KeepAwake(index);
+        return;
+    }
 
-        if (IsOutOfBounds(xPos + x, yPos + y)) //check if next desired position is out of bounds
+    for (size_t i = 0; i < bucket.size(); i++) //cells woken while the bucket is processed get appended to it
+    {
+        int index = bucket[i];
+        if (map[index].type != E || map[index].updateStamp == updateStamp) //cell changed or moved since it got queued
             continue;
 
-        int newIndex = (x + xPos) + WIDTH * (y + yPos);
-        int newIndexType = map[newIndex].type;
+        map[index].updateStamp = 0; //clear old stamp so it can't collide once the stamp wraps around
 
-        if (newIndexType == 0) //try to go to desired postion based on current rule, if next index is empty
-        {
-            SetCell(oldIndex, Element::Elements::UNOCCUPIED, false);
-            SetCell(newIndex, currentElement);
+        int x = index % WIDTH;
+        int y = index / WIDTH;
+        if (!UpdateKernel<E>(index, x, y) && CanAct<E>(x, y))
+            activeCells->KeepAwake(index);
+    }
+}
 
-            if (currentCell == 9) {
+//Try the rules of an element in order until one of them moves or reacts, returns true if the cell acted
+template<Element::Elements E>
+bool SandStorm::UpdateKernel(int index, int x, int y)
+{
+    constexpr size_t ruleCount = ElementRules::GetRules<E>().size();
+    return ApplyRules<E>(index, x, y, std::make_index_sequence<ruleCount>());
+}
 
-                map[newIndex].updateTick = map[oldIndex].updateTick;
-                map[newIndex].lifeTime = map[oldIndex].lifeTime;
-                map[newIndex].updateTick++;
+//Unrolls the rule set of an element, stops at the first rule that returns true
+template<Element::Elements E, size_t... I>
+bool SandStorm::ApplyRules(int index, int x, int y, std::index_sequence<I...>)
+{
+    return (TryRule<E, ElementRules::GetRules<E>()[I]>(index, x, y) || ...);
+}
 
-                map[oldIndex].updateTick = 0;
-                map[oldIndex].lifeTime = 0;
+//Move a cell to the position of a single rule if it is empty, otherwise try to interact with the cell at that position
+template<Element::Elements E, ElementRules::Rules R>
+bool SandStorm::TryRule(int index, int x, int y)
+{
+    int xPos = 0;
+    int yPos = ElementRules::GetOffsetY(R);
 
-                if (map[newIndex].updateTick == map[newIndex].lifeTime)
-                {
-                    map[newIndex].updateTick = 0;
-                    map[newIndex].lifeTime = 0;
+    if constexpr (ElementRules::IsSideRule(R))
+        xPos = random.GetValue(0, 1) == 0 ? -1 : 1;
 
-                    if (!GetChance(80)) SetCell(newIndex, Element::Elements::UNOCCUPIED, true);
-                    else SetCell(newIndex, Element::Elements::SMOKE, true);
+    if (IsOutOfBounds(xPos + x, yPos + y)) //check if next desired position is out of bounds
+        return false;
 
-                    break;
-                }
+    int newIndex = index + xPos + WIDTH * yPos;
+    int newIndexType = map[newIndex].type;
+
+    if (newIndexType == 0) //go to desired postion based on current rule, if next index is empty
+    {
+        SetCell(index, Element::Elements::UNOCCUPIED, false);
+        SetCell(newIndex, E);
+
+        if constexpr (E == Element::Elements::FIRE) //moving fire keeps its life time and burns out when it runs out
+        {
+            map[newIndex].updateTick = map[index].updateTick;
+            map[newIndex].lifeTime = map[index].lifeTime;
+            map[newIndex].updateTick++;
+
+            map[index].updateTick = 0;
+            map[index].lifeTime = 0;
+
+            if (map[newIndex].updateTick == map[newIndex].lifeTime)
+            {
+                map[newIndex].updateTick = 0;
+                map[newIndex].lifeTime = 0;
+
+                if (!GetChance(80)) SetCell(newIndex, Element::Elements::UNOCCUPIED, true);
+                else SetCell(newIndex, Element::Elements::SMOKE, true);
             }
-            break;
         }
+        return true;
+    }
 
-#pragma region CellInteractions
-        //swap sand with water if sand falls on top of water
-        if (currentCell == 1 && newIndexType == 2)
+    return Interact<E>(index, newIndex, newIndexType, x, y);
+}
+
+//Element specific interactions with the cell at a rule's position, returns true if the cell acted
+template<Element::Elements E>
+bool SandStorm::Interact(int oldIndex, int newIndex, int newIndexType, int x, int y)
+{
+    if constexpr (E == Element::Elements::SAND)
+    {
+        //swap sand with water, smoke or fire if sand falls on top of it
+        if (newIndexType == Element::Elements::WATER)
         {
             SwapCell(oldIndex, newIndex, Element::Elements::SAND, Element::Elements::WATER);
-            break;
+            return true;
         }
 
-        //swap sand with smoke if sand falls on top of water
-        if (currentCell == 1 && newIndexType == 4)
+        if (newIndexType == Element::Elements::SMOKE)
         {
             SwapCell(oldIndex, newIndex, Element::Elements::SAND, Element::Elements::SMOKE);
-            break;
+            return true;
         }
 
-        //swap sand with fire if sand falls on top of water
-        if (currentCell == 1 && newIndexType == 9)
+        if (newIndexType == Element::Elements::FIRE)
         {
             SwapCell(oldIndex, newIndex, Element::Elements::SAND, Element::Elements::FIRE);
-            break;
+            return true;
         }
+    }
 
-        //create smoke when water or sand touches 
-        bool createObsidianFromSand = currentCell == 1 && newIndexType == 5;
-        bool createObsidianFromWater = currentCell == 2 && newIndexType == 5;
-
-        if (createObsidianFromSand || createObsidianFromWater)
+    if constexpr (E == Element::Elements::SAND || E == Element::Elements::WATER)
+    {
+        //create smoke and obsidian when water or sand touches lava
+        if (newIndexType == Element::Elements::LAVA)
         {
             SetCell(oldIndex, Element::Elements::SMOKE);
             SetCell(newIndex, Element::Elements::OBSIDIAN);
-            break;
+            return true;
         }
+    }
 
+    if constexpr (E == Element::Elements::LAVA)
+    {
         //create obsidian when lava touches sand
-        if (currentCell == 5 && newIndexType == 1)
+        if (newIndexType == Element::Elements::SAND)
         {
             SetCell(newIndex, Element::Elements::OBSIDIAN);
-            break;
+            return true;
         }
 
         //create fire when lava touches wood
-        if (currentCell == 5 && newIndexType == 7) 
+        if (newIndexType == Element::Elements::WOOD)
         {
             SetCell(newIndex, Element::Elements::STATIONARY_FIRE);
-            break;
+            return true;
         }
+    }
 
+    if constexpr (E == Element::Elements::FIRE)
+    {
         //initial wood burning
-        if (currentCell == 9) 
+        int upIndex = oldIndex - WIDTH;
+        if (y > 0 && map[upIndex].type == Element::Elements::WOOD)
         {
-            int upIndex = oldIndex - HEIGHT;
-            if (map[upIndex].type == 7)
-            {
-                map[oldIndex].updateTick = 0;
-                map[oldIndex].lifeTime = 0;
+            map[oldIndex].updateTick = 0;
+            map[oldIndex].lifeTime = 0;
 
-                SetCell(oldIndex, Element::Elements::UNOCCUPIED, true);
-                SetCell(upIndex, Element::Elements::STATIONARY_FIRE, true);
-                break;
-            }
+            SetCell(oldIndex, Element::Elements::UNOCCUPIED, true);
+            SetCell(upIndex, Element::Elements::STATIONARY_FIRE, true);
+            return true;
         }
-        
-        //fire spreading logic
-        if (currentCell == 7)
+    }
+
+    if constexpr (E == Element::Elements::WOOD)
+    {
+        //fire spreading logic, only check neighbours that are inside the grid
+        bool burningUp = y > 0 && map[oldIndex - WIDTH].type == Element::Elements::STATIONARY_FIRE;
+        bool burningDown = y < HEIGHT - 1 && map[oldIndex + WIDTH].type == Element::Elements::STATIONARY_FIRE;
+        bool burningLeft = x > 0 && map[oldIndex - 1].type == Element::Elements::STATIONARY_FIRE;
+        bool burningRight = x < WIDTH - 1 && map[oldIndex + 1].type == Element::Elements::STATIONARY_FIRE;
+
+        if (burningUp || burningDown || burningLeft || burningRight)
         {
-            int upIndex = oldIndex - HEIGHT;
-            int downIndex = oldIndex + HEIGHT;
-            int leftIndex = oldIndex - 1;
-            int rightIndex = oldIndex + 1;
+            map[oldIndex].updateTick++;
 
-            if (map[upIndex].type == 8 || map[downIndex].type == 8 || map[leftIndex].type == 8 || map[rightIndex].type == 8)
+            if (map[oldIndex].updateTick == map[oldIndex].lifeTime)
             {
-                map[oldIndex].updateTick++;
-
-                if (map[oldIndex].updateTick == map[oldIndex].lifeTime)
-                {
-                    map[oldIndex].updateTick = 0;
-                    SetCell(oldIndex, Element::Elements::STATIONARY_FIRE, true);
-                    break;
-                }
+                map[oldIndex].updateTick = 0;
+                SetCell(oldIndex, Element::Elements::STATIONARY_FIRE, true);
+                return true;
             }
         }
-        
+    }
+
+    if constexpr (E == Element::Elements::STATIONARY_FIRE)
+    {
         //fire despawning
-        if (currentCell == 8) 
+        map[oldIndex].updateTick++;
+        if (map[oldIndex].updateTick == map[oldIndex].lifeTime)
         {
-            map[oldIndex].updateTick++;
-            if (map[oldIndex].updateTick == map[oldIndex].lifeTime)
+            map[oldIndex].updateTick = 0;
+            map[oldIndex].lifeTime = 0;
+
+            if (!GetChance(80)) SetCell(newIndex, Element::Elements::UNOCCUPIED, true);
+            else SetCell(newIndex, Element::Elements::SMOKE, true);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//Returns true if a cell that didn't act this tick could still act in a later tick without any of its neighbours changing
+template<Element::Elements E>
+bool SandStorm::CanAct(int x, int y)
+{
+    if constexpr (E == Element::Elements::STATIONARY_FIRE) //burns down over time
+    {
+        return true;
+    }
+    else if constexpr (E == Element::Elements::WOOD) //only burns while it touches fire
+    {
+        int index = x + WIDTH * y;
+        return (y > 0 && map[index - WIDTH].type == Element::Elements::STATIONARY_FIRE) ||
+            (y < HEIGHT - 1 && map[index + WIDTH].type == Element::Elements::STATIONARY_FIRE) ||
+            (x > 0 && map[index - 1].type == Element::Elements::STATIONARY_FIRE) ||
+            (x < WIDTH - 1 && map[index + 1].type == Element::Elements::STATIONARY_FIRE);
+    }
+    else //any position of its rules (both sides for SIDE rules) is empty or reactive
+    {
+        for (ElementRules::Rules rule : ElementRules::GetRules<E>())
+        {
+            int yPos = ElementRules::GetOffsetY(rule);
+            for (int xPos : { -1, 0, 1 })
             {
-                map[oldIndex].updateTick = 0;
-                map[oldIndex].lifeTime = 0;
-                
-                if (!GetChance(80)) SetCell(newIndex, Element::Elements::UNOCCUPIED, true);
-                else SetCell(newIndex, Element::Elements::SMOKE, true);
+                if ((xPos != 0) != ElementRules::IsSideRule(rule) || IsOutOfBounds(x + xPos, y + yPos))
+                    continue;
 
-                break;
+                unsigned char type = map[(x + xPos) + WIDTH * (y + yPos)].type;
+                if (type == Element::Elements::UNOCCUPIED || ElementRules::Reacts(E, type))
+                    return true;
             }
         }
-#pragma endregion 
+        return false;
     }
 }
+#pragma endregion
 
 //Helper method for setting single cells
 void SandStorm::SetCell(int index, Element::Elements element, bool markUpdated)
 {
+    OnCellChanged(index, map[index].type, element);
+
     pixels[index] = elementRules->GetCellColor(element);
     map[index].type = element;
-    map[index].isUpdated = markUpdated;
+    map[index].updateStamp = markUpdated ? updateStamp : 0;
 
     //Initialize dynamic cells with a random life time value
-    if (element == Element::Elements::STATIONARY_FIRE) map[index].lifeTime = GetRandomValue(75, 275);
-    if (element == Element::Elements::FIRE) map[index].lifeTime = GetRandomValue(25, 100);
-    if (element == Element::Elements::WOOD) map[index].lifeTime = GetRandomValue(10, 25);
+    if (element == Element::Elements::STATIONARY_FIRE) map[index].lifeTime = random.GetValue(75, 275);
+    if (element == Element::Elements::FIRE) map[index].lifeTime = random.GetValue(25, 100);
+    if (element == Element::Elements::WOOD) map[index].lifeTime = random.GetValue(10, 25);
 }
 
 //Helper method for swapping two cells with each other
 void SandStorm::SwapCell(int fromIndex, int toIndex, Element::Elements swapA, Element::Elements swapB)
 {
+    OnCellChanged(fromIndex, map[fromIndex].type, swapB);
+    OnCellChanged(toIndex, map[toIndex].type, swapA);
+
     pixels[fromIndex] = elementRules->GetCellColor(swapB);
     pixels[toIndex] = elementRules->GetCellColor(swapA);
     
     map[fromIndex].type = swapB;
     map[toIndex].type = swapA;
 
-    map[fromIndex].isUpdated = true;
-    map[toIndex].isUpdated = true;
+    map[fromIndex].updateStamp = updateStamp;
+    map[toIndex].updateStamp = updateStamp;
+}
+
+//Helper method for moving a cell (including its state and color) to an empty cell
+void SandStorm::MoveCell(int fromIndex, int toIndex)
+{
+    OnCellChanged(fromIndex, map[fromIndex].type, Element::Elements::UNOCCUPIED);
+    OnCellChanged(toIndex, Element::Elements::UNOCCUPIED, map[fromIndex].type);
+
+    map[toIndex] = map[fromIndex];
+    map[toIndex].updateStamp = updateStamp;
+    pixels[toIndex] = pixels[fromIndex];
+
+    map[fromIndex] = CellInfo();
+    pixels[fromIndex] = UNOCCUPIED_CELL;
+}
+
+//Keeps hash and engine side data in sync, called for every cell type change
+void SandStorm::OnCellChanged(int index, unsigned char oldType, unsigned char newType)
+{
+    stateHasher->OnCellChanged(index, oldType, newType);
+    bitplaneEngine->OnCellChanged(index, oldType, newType);
+    chunkMap->OnCellChanged(index, oldType, newType);
+    liquidPools->OnCellChanged(index);
+    activeCells->Wake(index);
 }
 
 //Placing / destroying cells with mouse
-void SandStorm::ManipulateCell(bool state, int xPos, int yPos, Element::Elements placeElement, int overrideBrushSize)
+void SandStorm::ManipulateCell(bool state, int xPos, int yPos, Element::Elements placeElement, int overrideBrushSize, bool recordHistory)
 {
     int radius = overrideBrushSize == 0 ? this->brushSize : overrideBrushSize;
     for (int x = -radius; x <= radius; x++)
@@ -331,15 +620,19 @@ void SandStorm::ManipulateCell(bool state, int xPos, int yPos, Element::Elements
                     if (GetChance(fillChance))
                     {
                         if (map[index].type == 0)
+                        {
+                            if (recordHistory) editHistory->RecordCell(index, map[index].type, placeElement);
                             SetCell(index, placeElement, false);
+                        }
                     }
                 }
                 else //destroying cells
                 {
                     if (map[index].type > 0)
                     {
+                        if (recordHistory) editHistory->RecordCell(index, map[index].type, Element::UNOCCUPIED);
                         SetCell(index, Element::UNOCCUPIED, false);
-                        map[index].isUpdated = false;
+                        map[index].updateStamp = 0;
                         map[index].lifeTime = 0;
                         map[index].updateTick = 0;
                     }
@@ -365,23 +658,36 @@ void SandStorm::HandleCellSwitching()
    
     if (IsMouseButtonPressed(MOUSE_BUTTON_MIDDLE)) //temp debugging shortcut to spawn sand cell
     {
-        Element::Elements debugElement = Element::Elements::SAND;
         int index = 256 + WIDTH * 256;
-        pixels[index] = elementRules->GetCellColor(debugElement);
-        map[index].type = debugElement;
+        SetCell(index, Element::Elements::SAND, false);
     }
 }
 
+//Returns the element type of a single cell
+unsigned char SandStorm::GetCellType(int index)
+{
+    return map[index].type;
+}
+
 //Helper method for clearing the simulation grid
 void SandStorm::ResetSim()
 {
-    std::fill(std::begin(pixels), std::end(pixels), UNOCCUPIED_CELL);
-    std::fill(std::begin(map), std::end(map), CellInfo());
- 
+    editHistory->BeginGridEdit();
+
+    std::fill(pixels.begin(), pixels.end(), UNOCCUPIED_CELL);
+    std::fill(map.begin(), map.end(), CellInfo());
+    stateHasher->Reset();
+    bitplaneEngine->Reset();
+    chunkMap->Reset();
+    activeCells->Reset();
+    liquidPools->Reset();
+
     imageImporter->currentImportedImage = "";
     autoManipulators.clear();
 
-    PlaySound(SandStorm::instance->resetSFX);
+    editHistory->EndGridEdit();
+    if (!headless)
+        PlaySound(resetSFX);
 }
 
 //Helper method for creating and exporting screenshots
@@ -411,6 +717,38 @@ void SandStorm::ExportScreenShot()
     UnloadImage(image);
 }
 
+//Publish frames and cell types into a shared memory ring that external tools can map
+void SandStorm::EnableSharedExport(const std::string& name, int publishInterval)
+{
+    delete sharedFrameExport;
+    sharedFrameExport = new SharedFrameExport(name, WIDTH, HEIGHT); //create SharedFrameExport ref
+    if (publishInterval > 0) sharedFrameExport->publishInterval = publishInterval; //0 keeps the default interval
+
+    if (!sharedFrameExport->IsOpen())
+    {
+        delete sharedFrameExport;
+        sharedFrameExport = nullptr;
+    }
+}
+
+//Seeds the random generator so runs can be reproduced
+void SandStorm::SetSeed(unsigned int seed)
+{
+    this->seed = seed;
+    random.SetSeed(seed);
+}
+
+//Recalculates the grid hash from scratch (used to validate the incremental hash)
+uint64_t SandStorm::ComputeStateHash()
+{
+    uint64_t hash = 0;
+    for (int i = 0; i < size; i++)
+    {
+        hash ^= StateHasher::CellKey(i, map[i].type);
+    }
+    return hash;
+}
+
 //Checks if given position is outside the window
 bool SandStorm::IsOutOfBounds(int posX, int posY)
 {
@@ -423,7 +761,7 @@ bool SandStorm::IsOutOfBounds(int posX, int posY)
 //Calculates and returns a chance based on input value
 bool SandStorm::GetChance(float input)
 {
-    return GetRandomValue(0, 100) > input;
+    return random.GetValue(0, 100) > input;
 }
 
 //Convert current element enum value to string for UI label
@@ -440,4 +778,17 @@ std::string SandStorm::GetElementString()
         case 9:  return "Fire " +      std::to_string(brushSize);
         default: return "UNDIFINED " + std::to_string(brushSize);
     }
-}
\ No newline at end of file
+}
+
+//Convert current scan order enum value to string for UI label
+std::string SandStorm::GetScanOrderString()
+{
+    switch (scanOrder)
+    {
+        case ScanOrder::COLUMN_MAJOR:                   return "Column major";
+        case ScanOrder::ROW_BOTTOM_UP:                  return "Bottom up";
+        case ScanOrder::ROW_BOTTOM_UP_ALTERNATE_ROW:    return "Bottom up, alternating rows";
+        case ScanOrder::ROW_BOTTOM_UP_ALTERNATE_TICK:   return "Bottom up, alternating ticks";
+        default:                                        return "UNDIFINED";
+    }
+}
@@ -4,31 +4,50 @@
 #include <string>
 #include <chrono>
 #include <ctime>
+#include <thread>
+#include <utility>
 
 #include "raylib.h"
 #include "ElementRules.h"
 #include "InputHandler.h"
 #include "ImageImporter.h"
+#include "StateHasher.h"
+#include "UpdateScheduler.h"
+#include "RandomGenerator.h"
+
+class MargolusEngine;
+class BitplaneEngine;
+class ChunkMap;
+class EditHistory;
+class ActiveCells;
+class LiquidPools;
+class SharedFrameExport;
 
 class SandStorm 
 {
 public:
-	SandStorm();
+	SandStorm(bool headless = false);
 	~SandStorm();
 
 	void Update(float deltaTime);
 	void Render();
+	void Step();
 
 	void SetCell(int index, Element::Elements element, bool markUpdated = true);
-	void ManipulateCell(bool state, int x, int y, Element::Elements placeElement, int overrideBrushSize = 0);
+	void MoveCell(int fromIndex, int toIndex);
+	void ManipulateCell(bool state, int x, int y, Element::Elements placeElement, int overrideBrushSize = 0, bool recordHistory = false);
+	unsigned char GetCellType(int index);
 
 	void ResetSim();
 	void ExportScreenShot();
+	void EnableSharedExport(const std::string& name, int publishInterval = 0);
+
+	void SetSeed(unsigned int seed);
+	uint64_t ComputeStateHash();
 
 	int brushSize = 10;
 	int brushSizeScaler = 5;
 	
-	static SandStorm* instance;
 	Element::Elements currentElement = Element::Elements::SAND;
 		
 	Sound removeAutoSFX;
@@ -39,7 +58,7 @@ public:
 		unsigned char type = 0;
 		unsigned char updateTick = 0;
 		unsigned char lifeTime = 0;
-		bool isUpdated = false;
+		unsigned char updateStamp = 0;
 	};
 
 	typedef struct AutoCellManipulator {
@@ -57,13 +76,57 @@ public:
 	};
 	std::vector<AutoCellManipulator> autoManipulators;
 	ImageImporter* imageImporter = nullptr;
+	StateHasher* stateHasher = nullptr;
+	UpdateScheduler* updateScheduler = nullptr;
+	ChunkMap* chunkMap = nullptr;
+	EditHistory* editHistory = nullptr;
 	
+	enum ScanOrder
+	{
+		COLUMN_MAJOR,
+		ROW_BOTTOM_UP,
+		ROW_BOTTOM_UP_ALTERNATE_ROW,
+		ROW_BOTTOM_UP_ALTERNATE_TICK
+	};
+	ScanOrder scanOrder = ScanOrder::ROW_BOTTOM_UP_ALTERNATE_ROW;
+	std::string GetScanOrderString();
+
+	enum UpdateEngine
+	{
+		CELLULAR,
+		MARGOLUS
+	};
+	UpdateEngine updateEngine = UpdateEngine::CELLULAR;
+	MargolusEngine* margolusEngine = nullptr;
+
+	bool useBitplanes = true;
+	BitplaneEngine* bitplaneEngine = nullptr;
+
+	bool useActiveLists = true;
+	ActiveCells* activeCells = nullptr;
+	LiquidPools* liquidPools = nullptr;
+
+	SharedFrameExport* sharedFrameExport = nullptr; //only created with --share, nothing is published otherwise
+
 	bool shouldUpdate = true;
 	bool skipTimerActive = false;
 	bool showHudInfo = true;
+	bool headless = false; //headless instances have no textures/audio and are only stepped (golden/batch runs)
 
 private:
+	void StepCellular();
 	void UpdateCell(int x, int y);
+	void UpdateMaskedRow(int y, const uint64_t* mask, bool leftToRight);
+	void UpdateActiveCells();
+
+	//Per element update kernels, rules and interactions are resolved at compile time
+	template<Element::Elements E> void UpdateBucket();
+	template<Element::Elements E> bool UpdateKernel(int index, int x, int y);
+	template<Element::Elements E, size_t... I> bool ApplyRules(int index, int x, int y, std::index_sequence<I...>);
+	template<Element::Elements E, ElementRules::Rules R> bool TryRule(int index, int x, int y);
+	template<Element::Elements E> bool Interact(int oldIndex, int newIndex, int newIndexType, int x, int y);
+	template<Element::Elements E> bool CanAct(int x, int y);
+	void OnCellChanged(int index, unsigned char oldType, unsigned char newType);
 	
 	void SwapCell(int fromIndex, int toIndex, Element::Elements swapA, Element::Elements swapB);
 
@@ -78,6 +141,10 @@ private:
 	ElementRules* elementRules = nullptr;
 
 	Color UNOCCUPIED_CELL = Color(0, 0, 0, 255);
+
+	std::vector<CellInfo> map;
+	std::vector<Color> pixels;
+	RandomGenerator random;
 	
 	Texture2D cursor;
 	Texture2D screenTexture;
@@ -87,6 +154,11 @@ private:
 	int cursorOrigin = 7;
 	char timeBuffer[20];
 
+	unsigned char updateStamp = 1;
+	unsigned int seed = 0;
+	bool bitplanesDirty = false;
+	bool activeCellsDirty = false;
+
 	float cellPlacingNoRandomization = 0;
 	float cellPlacingRandomization = 99;
 };
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "SharedFrameExport.h"
+
+#include <cstring>
+#include <iostream>
+#include <new>
+
+//raylib.h isn't included here, its names clash with the windows headers
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "sequence counters have to be lock free to be shared between processes");
+
+constexpr size_t ALIGNMENT = 64; //keep slots and planes on their own cache lines
+
+static size_t Align(size_t value)
+{
+    return (value + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+#ifndef _WIN32
+//Checks if an existing shared memory object was created by SandStorm, objects of other programs are never replaced
+static bool IsSandStormObject(const std::string& objectName)
+{
+    int descriptor = shm_open(objectName.c_str(), O_RDONLY, 0);
+    if (descriptor < 0)
+        return false;
+
+    bool isSandStorm = false;
+    struct stat info;
+    if (fstat(descriptor, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(SharedFrameExport::SharedHeader))
+    {
+        void* view = mmap(nullptr, sizeof(SharedFrameExport::SharedHeader), PROT_READ, MAP_SHARED, descriptor, 0);
+        if (view != MAP_FAILED)
+        {
+            isSandStorm = static_cast<const SharedFrameExport::SharedHeader*>(view)->magic == SharedFrameExport::MAGIC;
+            munmap(view, sizeof(SharedFrameExport::SharedHeader));
+        }
+    }
+    close(descriptor);
+    return isSandStorm;
+}
+#endif
+
+SharedFrameExport::SharedFrameExport(const std::string& name, int width, int height, int slotCount)
+{
+    this->width = width;
+    this->height = height;
+    this->slotCount = slotCount;
+
+    size_t cellCount = static_cast<size_t>(width) * height;
+    size_t pixelsOffset = Align(sizeof(SlotHeader));
+    size_t typesOffset = Align(pixelsOffset + cellCount * 4);
+
+    slotSize = Align(typesOffset + cellCount);
+    memorySize = Align(sizeof(SharedHeader)) + slotSize * slotCount;
+
+    if (!Map(name))
+    {
+        std::cout << "[share] failed to create shared memory '" << name << "'\n";
+        return;
+    }
+
+    header = new (memory) SharedHeader();
+    header->magic = MAGIC;
+    header->version = VERSION;
+    header->width = width;
+    header->height = height;
+    header->slotCount = slotCount;
+    header->slotSize = static_cast<uint32_t>(slotSize);
+    header->pixelsOffset = static_cast<uint32_t>(pixelsOffset);
+    header->typesOffset = static_cast<uint32_t>(typesOffset);
+    header->latestFrame.store(0, std::memory_order_release);
+
+    for (int slot = 0; slot < slotCount; slot++)
+    {
+        new (static_cast<char*>(memory) + Align(sizeof(SharedHeader)) + slotSize * slot) SlotHeader();
+    }
+
+    std::cout << "[share] publishing " << width << "x" << height << " frames to '" << name << "' (" << memorySize / 1024 << " KB)\n";
+}
+
+SharedFrameExport::~SharedFrameExport()
+{
+    Unmap();
+}
+
+//Returns true if the shared memory could be created
+bool SharedFrameExport::IsOpen()
+{
+    return header != nullptr;
+}
+
+//Copy a frame into the next slot of the ring, cellTypes points to the type of the first cell and cells are cellStride bytes apart
+void SharedFrameExport::Publish(const void* pixels, const unsigned char* cellTypes, int cellStride, uint64_t tick, uint64_t stateHash)
+{
+    if (header == nullptr)
+        return;
+
+    char* slotMemory = static_cast<char*>(memory) + Align(sizeof(SharedHeader)) + slotSize * (frame % slotCount);
+    SlotHeader* slot = reinterpret_cast<SlotHeader*>(slotMemory);
+
+    slot->sequence.store(2 * frame + 1, std::memory_order_relaxed); //odd, readers drop the slot while it is written
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->frame = frame;
+    slot->tick = tick;
+    slot->stateHash = stateHash;
+
+    size_t cellCount = static_cast<size_t>(width) * height;
+    std::memcpy(slotMemory + header->pixelsOffset, pixels, cellCount * 4);
+
+    unsigned char* types = reinterpret_cast<unsigned char*>(slotMemory + header->typesOffset);
+    for (size_t i = 0; i < cellCount; i++)
+    {
+        types[i] = cellTypes[i * cellStride];
+    }
+
+    slot->sequence.store(2 * frame + 2, std::memory_order_release);
+    header->latestFrame.store(frame + 1, std::memory_order_release);
+    frame++;
+}
+
+//Create and map the named shared memory object, an existing object with the same name is never mapped
+bool SharedFrameExport::Map(const std::string& name)
+{
+#ifdef _WIN32
+    objectName = "Local\\" + name;
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(static_cast<uint64_t>(memorySize) >> 32), static_cast<DWORD>(memorySize), objectName.c_str());
+    if (mapping == nullptr)
+        return false;
+
+    if (GetLastError() == ERROR_ALREADY_EXISTS) //named mappings only live as long as a handle is open, so another process owns this one
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, memorySize);
+    if (memory == nullptr)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+    mappingHandle = mapping;
+#else
+    objectName = "/" + name;
+    fileDescriptor = shm_open(objectName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fileDescriptor < 0 && errno == EEXIST && IsSandStormObject(objectName)) //left behind by a run that didn't shut down cleanly
+    {
+        std::cout << "[share] replacing stale shared memory '" << name << "'\n";
+        shm_unlink(objectName.c_str());
+        fileDescriptor = shm_open(objectName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fileDescriptor < 0)
+        return false;
+
+    if (ftruncate(fileDescriptor, memorySize) != 0)
+    {
+        Unmap();
+        return false;
+    }
+
+    memory = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+    if (memory == MAP_FAILED)
+    {
+        memory = nullptr;
+        Unmap();
+        return false;
+    }
+#endif
+    return true;
+}
+
+//Unmap and release the shared memory object, readers that still have it mapped keep their view
+void SharedFrameExport::Unmap()
+{
+#ifdef _WIN32
+    if (memory != nullptr) UnmapViewOfFile(memory);
+    if (mappingHandle != nullptr) CloseHandle(mappingHandle);
+#else
+    if (memory != nullptr) munmap(memory, memorySize);
+    if (fileDescriptor >= 0)
+    {
+        close(fileDescriptor);
+        shm_unlink(objectName.c_str());
+    }
+#endif
+    memory = nullptr;
+    mappingHandle = nullptr;
+    fileDescriptor = -1;
+    header = nullptr;
+}
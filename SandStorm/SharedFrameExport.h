@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//Publishes rendered frames and the cell type plane into a named shared memory ring for external tools.
+//Layout: SharedHeader, followed by slotCount slots of slotSize bytes. Every slot starts with a SlotHeader,
+//followed by width * height RGBA pixels (pixelsOffset) and width * height cell types (typesOffset).
+//Frame N is written to slot N % slotCount. A slot's sequence is odd while it is being written and 2 * (N + 1)
+//once frame N is complete, readers check it before and after reading a slot and drop the frame when it changed.
+//The writer never waits for readers.
+class SharedFrameExport
+{
+public:
+	SharedFrameExport(const std::string& name, int width, int height, int slotCount = 4);
+	~SharedFrameExport();
+
+	bool IsOpen();
+	void Publish(const void* pixels, const unsigned char* cellTypes, int cellStride, uint64_t tick, uint64_t stateHash);
+
+	typedef struct SharedHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t slotCount;
+		uint32_t slotSize;
+		uint32_t pixelsOffset;
+		uint32_t typesOffset;
+		std::atomic<uint64_t> latestFrame; //newest complete frame + 1, 0 = nothing published yet
+	};
+
+	typedef struct SlotHeader {
+		std::atomic<uint64_t> sequence;
+		uint64_t frame;
+		uint64_t tick;
+		uint64_t stateHash;
+	};
+
+	static constexpr uint32_t MAGIC = 0x4D485353; //'SSHM'
+	static constexpr uint32_t VERSION = 1;
+
+	int publishInterval = 4; //publish every N ticks, the sim ticks at up to 240 fps so this matches a 60 Hz display
+
+private:
+	bool Map(const std::string& name);
+	void Unmap();
+
+	int width = 0;
+	int height = 0;
+	int slotCount = 0;
+	size_t slotSize = 0;
+	size_t memorySize = 0;
+
+	void* memory = nullptr;
+	void* mappingHandle = nullptr; //windows file mapping handle
+	int fileDescriptor = -1; //posix shared memory object
+	std::string objectName;
+
+	SharedHeader* header = nullptr;
+	uint64_t frame = 0;
+};
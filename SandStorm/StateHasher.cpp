@@ -0,0 +1,61 @@
+#include "StateHasher.h"
+
+StateHasher::StateHasher(int checkpointInterval)
+{
+    this->checkpointInterval = checkpointInterval;
+}
+
+//Incrementally update the grid hash when a single cell changes type
+void StateHasher::OnCellChanged(int index, unsigned char oldType, unsigned char newType)
+{
+    if (oldType == newType)
+        return;
+
+    currentHash ^= CellKey(index, oldType) ^ CellKey(index, newType);
+}
+
+//Apply a combined change of many cells (hashes of multiple changes can be XOR'ed together in any order)
+void StateHasher::ApplyDelta(uint64_t hashDelta)
+{
+    currentHash ^= hashDelta;
+}
+
+//Advance the tick counter and store a checkpoint every N ticks
+void StateHasher::OnTick()
+{
+    tick++;
+    if (checkpointInterval > 0 && tick % checkpointInterval == 0)
+        checkpoints.push_back(currentHash);
+}
+
+//Clear hash and checkpoints (an empty grid hashes to 0)
+void StateHasher::Reset()
+{
+    currentHash = 0;
+    tick = 0;
+    checkpoints.clear();
+}
+
+//Returns the hash contribution of a single cell, empty cells don't contribute
+uint64_t StateHasher::CellKey(int index, unsigned char type)
+{
+    if (type == 0)
+        return 0;
+
+    return Mix((static_cast<uint64_t>(index) << 8) | type);
+}
+
+//SplitMix64 finalizer, spreads input bits over the whole 64 bit value
+uint64_t StateHasher::Mix(uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+//Returns a random seed for a single tick, engines derive position based random values from this
+uint64_t StateHasher::TickSeed(unsigned int seed, int tick)
+{
+    return Mix((static_cast<uint64_t>(seed) << 32) | static_cast<uint32_t>(tick));
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+class StateHasher
+{
+public:
+	StateHasher(int checkpointInterval = 60);
+
+	void OnCellChanged(int index, unsigned char oldType, unsigned char newType);
+	void ApplyDelta(uint64_t hashDelta);
+	void OnTick();
+	void Reset();
+
+	static uint64_t CellKey(int index, unsigned char type);
+	static uint64_t Mix(uint64_t value);
+	static uint64_t TickSeed(unsigned int seed, int tick);
+
+	uint64_t currentHash = 0;
+	int tick = 0;
+	int checkpointInterval = 60;
+
+	std::vector<uint64_t> checkpoints;
+};
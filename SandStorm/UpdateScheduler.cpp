@@ -0,0 +1,70 @@
+#include "UpdateScheduler.h"
+
+UpdateScheduler::UpdateScheduler()
+{
+    for (int element = 0; element < Element::ELEMENT_COUNT; element++)
+    {
+        isActive[element] = true;
+        updatePeriod[element] = 1;
+        degradeFromLevel[element] = 0;
+    }
+
+    //gases never settle, update them every other tick
+    updatePeriod[Element::Elements::SMOKE] = 2;
+
+    //cheap/short lived elements give up time first, liquids next, sand only when everything else is already degraded
+    degradeFromLevel[Element::Elements::SMOKE] = 1;
+    degradeFromLevel[Element::Elements::FIRE] = 1;
+    degradeFromLevel[Element::Elements::STATIONARY_FIRE] = 1;
+    degradeFromLevel[Element::Elements::WATER] = 2;
+    degradeFromLevel[Element::Elements::LAVA] = 2;
+    degradeFromLevel[Element::Elements::SAND] = 3;
+}
+
+//Decide which elements get updated this tick
+void UpdateScheduler::BeginTick(int tick)
+{
+    for (int element = 0; element < Element::ELEMENT_COUNT; element++)
+    {
+        int period = updatePeriod[element];
+        if (degradeFromLevel[element] > 0 && degradeLevel >= degradeFromLevel[element]) //every level past its threshold doubles an element's period
+            period <<= degradeLevel - degradeFromLevel[element] + 1;
+
+        isActive[element] = (tick + element) % period == 0; //offset by element so not all slow elements update on the same tick
+    }
+}
+
+//Adapt the degrade level to the time the last tick took
+void UpdateScheduler::EndTick(double tickTimeMs)
+{
+    totalTicks++;
+    if (degradeLevel > 0)
+        degradedTicks++;
+
+    if (!adaptive)
+        return;
+
+    averageTickTimeMs = averageTickTimeMs * 0.9 + tickTimeMs * 0.1; //smooth out single slow ticks
+
+    ticksSinceLevelChange++;
+    if (ticksSinceLevelChange < levelChangeDelay)
+        return;
+
+    if (averageTickTimeMs > tickBudgetMs && degradeLevel < maxDegradeLevel)
+    {
+        degradeLevel++;
+        ticksSinceLevelChange = 0;
+    }
+    else if (averageTickTimeMs < tickBudgetMs * 0.5 && degradeLevel > 0)
+    {
+        degradeLevel--;
+        ticksSinceLevelChange = 0;
+    }
+}
+
+//Returns degrade info for the UI label
+std::string UpdateScheduler::GetStatusString()
+{
+    int degradedPercentage = totalTicks == 0 ? 0 : degradedTicks * 100 / totalTicks;
+    return "Degrade " + std::to_string(degradeLevel) + " (" + std::to_string(degradedPercentage) + "% of ticks)";
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+
+#include "Element.h"
+
+class UpdateScheduler
+{
+public:
+	UpdateScheduler();
+
+	void BeginTick(int tick);
+	void EndTick(double tickTimeMs);
+
+	std::string GetStatusString();
+
+	bool isActive[Element::ELEMENT_COUNT]; //elements that get updated this tick
+
+	int updatePeriod[Element::ELEMENT_COUNT]; //update an element every N ticks
+	int degradeFromLevel[Element::ELEMENT_COUNT]; //degrade level from which an element gets updated less often, 0 = never degraded
+
+	bool adaptive = true;
+	float tickBudgetMs = 4.0f;
+
+	int degradeLevel = 0;
+	int maxDegradeLevel = 4;
+
+	int totalTicks = 0;
+	int degradedTicks = 0;
+
+private:
+	double averageTickTimeMs = 0;
+	int ticksSinceLevelChange = 0;
+	int levelChangeDelay = 30;
+};